@@ -8,6 +8,7 @@
 
 #ifndef APU_H_
 #define APU_H_
+#include <avr/pgmspace.h>
 #include "trigintlib/trigint.h"
 #define apuregsize 0x0018
 #define aputop 0x4000
@@ -15,7 +16,11 @@
 #define CPUCLOCK 1789773
 #define SAMPLERATE 8192 //8.192khz sample rate
 #define ANGLEPERSTEP 2 //equivalent to TRIGINT_ANGLES_PER_CYCLE/SAMPLERATE
-#define harmonics 4 //how many additions of sine do we want
+#define WAVESIZE 64 //samples in one period of a wavetable, the top 6 bits of the angle pick one
+#define WAVELEVELS 5 //level l has harmonics up to 16 >> l so high notes dont alias
+
+//band limited pulse for each duty cycle, made by pulsetables.c from the same series SampleAPU used to add up every sample
+#include "pulsetables.h"
 
 struct pulsegen{
 	unsigned char regs[4];
@@ -73,24 +78,16 @@ unsigned char SampleAPU(struct apu *a){
 	if (t < 8){return 128;}
 	unsigned short f = CPUCLOCK/(16* (t+1));//magic calculation im getting off of http://wiki.nesdev.com/w/index.php/APU_Misc
 	unsigned short angleinc = f*ANGLEPERSTEP;//this will be off slightly probably
-	a->currangle += angleinc;
-	unsigned char amp = 128;
-	for (unsigned char i = 0; i < harmonics; i++){
-		unsigned char harm = (i*2)+1;
-		trigint_angle_t angle = a->currangle*(harm);
-		angle = angle & TRIGINT_ANGLE_MAX;
-		unsigned char tempamp = trigint_sin8u(angle);
-		if (tempamp < 128){
-			tempamp = (128 - tempamp);
-			tempamp /= harm;
-			amp -= tempamp;
-		}
-		else{
-			tempamp = tempamp - 128;
-			tempamp /= harm;
-			amp += tempamp;
-		}
+	a->currangle = (a->currangle + angleinc) & TRIGINT_ANGLE_MAX;
+	unsigned char level = 0;//first level whose top harmonic is under half the sample rate
+	while (level < WAVELEVELS - 1 && f >= ((SAMPLERATE / 2 / 16) << level)){
+		level++;
 	}
-	return amp;
+	const unsigned char* table = pulsetables[(a->pulse1.regs[0] >> 6) & 0x03][level];
+	unsigned char i = a->currangle >> 8;
+	unsigned char frac = a->currangle & 0xFF;
+	unsigned char now = pgm_read_byte(&table[i]);
+	unsigned char next = pgm_read_byte(&table[(i + 1) & (WAVESIZE - 1)]);
+	return now + (((int)(next - now) * (frac >> 1)) >> 7);//straight line between the two samples either side, 7 bits so it fits in an int
 }
 #endif /* APU_H_ */
\ No newline at end of file
@@ -0,0 +1,42 @@
+/*
+ * pulsetables.c
+ *
+ * writes pulsetables.h, the band limited pulse wavetables apu.h plays out of program memory
+ * runs on the machine doing the build, not the avr, see the makefile here
+ * each table adds up the harmonics of a sawtooth take away the same one delayed by the duty cycle,
+ * with the sigma factor keeping the ringing at the edges down, centered on 128
+ */
+#include <stdio.h>
+#include <math.h>
+#define WAVESIZE 64 //has to match apu.h
+#define WAVELEVELS 5
+#define TOPHARMONIC 16 //harmonics in level 0, each level after has half as many
+
+int main(void){
+	const double duties[4] = {1.0/8.0,1.0/4.0,1.0/2.0,3.0/4.0};
+	const char* names[4] = {"12.5","25","50","75"};
+	printf("//made by pulsetables.c, run make in this folder after changing it instead of editing this\n");
+	printf("const unsigned char pulsetables[4][WAVELEVELS][WAVESIZE] PROGMEM = {\n");
+	for (int d = 0; d < 4; d++){
+		printf("\t{//%s%% duty\n",names[d]);
+		for (int l = 0; l < WAVELEVELS; l++){
+			int top = TOPHARMONIC >> l;
+			printf("\t\t{");
+			for (int n = 0; n < WAVESIZE; n++){
+				double sum = 0;
+				for (int h = 1; h <= top; h++){
+					double sigma = sin(M_PI * h / (top + 1)) / (M_PI * h / (top + 1));
+					sum += sigma * (sin(2 * M_PI * h * n / WAVESIZE) - sin(2 * M_PI * h * ((double)n / WAVESIZE - duties[d]))) / (M_PI * h);
+				}
+				int v = (int)floor(128 + 100 * sum + 0.5);
+				if (v < 0){v = 0;}
+				if (v > 255){v = 255;}
+				printf("%d%s",v,n < WAVESIZE - 1 ? "," : "");
+			}
+			printf("}%s//up to harmonic %d\n",l < WAVELEVELS - 1 ? "," : "",top);
+		}
+		printf("\t}%s\n",d < 3 ? "," : "");
+	}
+	printf("};\n");
+	return 0;
+}
@@ -0,0 +1,31 @@
+//made by pulsetables.c, run make in this folder after changing it instead of editing this
+const unsigned char pulsetables[4][WAVELEVELS][WAVESIZE] PROGMEM = {
+	{//12.5% duty
+		{165,195,212,216,216,216,212,195,165,136,119,114,115,116,115,115,116,116,115,115,116,116,115,115,116,116,115,115,116,116,115,115,116,116,115,115,116,115,115,116,116,115,115,116,116,115,115,116,116,115,115,116,116,115,115,116,116,115,115,116,115,114,119,136},//up to harmonic 16
+		{165,182,197,207,211,207,197,182,165,149,135,124,118,115,114,115,115,116,116,116,115,115,115,115,116,116,116,115,115,115,115,116,116,116,116,115,115,115,116,116,116,116,115,115,115,115,116,116,116,115,115,115,115,116,116,116,115,115,114,115,118,124,135,149},//up to harmonic 8
+		{165,172,177,180,181,180,177,172,165,157,149,141,133,127,122,118,116,114,114,114,115,115,116,116,116,116,116,116,115,115,115,115,115,116,116,116,116,116,116,116,115,115,115,115,115,116,116,116,116,116,116,115,115,114,114,114,116,118,122,127,133,141,149,157},//up to harmonic 4
+		{153,155,156,157,157,157,156,155,153,151,148,145,142,139,136,132,129,126,123,121,119,117,115,114,114,113,113,113,114,114,115,115,116,116,117,117,117,117,117,116,116,115,115,114,114,113,113,113,114,114,115,117,119,121,123,126,129,132,136,139,142,145,148,151},//up to harmonic 2
+		{142,143,143,143,144,143,143,143,142,142,141,140,139,138,137,135,134,133,131,130,128,126,125,123,122,121,119,118,117,116,115,114,114,113,113,113,112,113,113,113,114,114,115,116,117,118,119,121,122,123,125,126,128,130,131,133,134,135,137,138,139,140,141,142}//up to harmonic 1
+	},
+	{//25% duty
+		{153,182,200,204,203,203,203,203,203,203,203,203,203,204,200,182,153,124,107,102,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,102,107,124},//up to harmonic 16
+		{153,169,183,194,201,204,204,203,203,203,204,204,201,194,183,169,153,137,123,112,106,102,102,102,103,104,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,103,104,103,102,102,102,106,112,123,137},//up to harmonic 8
+		{152,162,171,179,187,193,198,201,202,201,198,193,187,179,171,162,152,143,135,127,120,114,110,106,104,102,102,102,102,102,103,103,104,104,104,104,103,103,103,102,102,102,103,103,103,104,104,104,104,103,103,102,102,102,102,102,104,106,110,114,120,127,135,143},//up to harmonic 4
+		{154,159,164,168,172,175,177,178,178,178,177,175,172,168,164,159,154,149,144,138,133,128,123,119,115,111,109,106,104,103,102,102,102,102,102,102,103,103,104,104,104,104,104,103,103,102,102,102,102,102,102,103,104,106,109,111,115,119,123,128,133,138,144,149},//up to harmonic 2
+		{148,150,152,153,154,155,156,157,157,157,156,155,154,153,152,150,148,146,144,142,139,136,134,131,128,125,122,120,117,114,112,110,108,106,104,103,102,101,100,99,99,99,100,101,102,103,104,106,108,110,112,114,117,120,122,125,128,131,134,136,139,142,144,146}//up to harmonic 1
+	},
+	{//50% duty
+		{128,157,174,179,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,178,179,174,157,128,99,82,77,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,78,77,82,99},//up to harmonic 16
+		{128,144,158,169,176,179,179,179,178,177,178,178,178,178,178,178,178,178,178,178,178,178,178,177,178,179,179,179,176,169,158,144,128,112,98,87,80,77,77,77,78,79,78,78,78,78,78,78,78,78,78,78,78,78,78,79,78,77,77,77,80,87,98,112},//up to harmonic 8
+		{128,137,146,154,161,167,172,175,178,179,180,179,179,178,178,177,177,177,178,178,179,179,180,179,178,175,172,167,161,154,146,137,128,119,110,102,95,89,84,81,78,77,76,77,77,78,78,79,79,79,78,78,77,77,76,77,78,81,84,89,95,102,110,119},//up to harmonic 4
+		{128,133,138,143,148,153,157,161,165,169,172,174,177,178,180,180,181,180,180,178,177,174,172,169,165,161,157,153,148,143,138,133,128,123,118,113,108,103,99,95,91,87,84,82,79,78,76,76,75,76,76,78,79,82,84,87,91,95,99,103,108,113,118,123},//up to harmonic 2
+		{128,132,136,140,144,147,151,154,157,159,162,164,165,167,168,168,169,168,168,167,165,164,162,159,157,154,151,147,144,140,136,132,128,124,120,116,112,109,105,102,99,97,94,92,91,89,88,88,87,88,88,89,91,92,94,97,99,102,105,109,112,116,120,124}//up to harmonic 1
+	},
+	{//75% duty
+		{103,132,149,154,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,154,149,132,103,74,56,52,53,53,53,53,53,53,53,53,53,52,56,74},//up to harmonic 16
+		{103,119,133,144,150,154,154,154,153,152,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,153,152,153,154,154,154,150,144,133,119,103,87,73,62,55,52,52,53,53,53,52,52,55,62,73,87},//up to harmonic 8
+		{104,113,121,129,136,142,146,150,152,154,154,154,154,154,153,153,152,152,152,152,153,153,153,154,154,154,153,153,153,152,152,152,152,153,153,154,154,154,154,154,152,150,146,142,136,129,121,113,104,94,85,77,69,63,58,55,54,55,58,63,69,77,85,94},//up to harmonic 4
+		{102,107,112,118,123,128,133,137,141,145,147,150,152,153,154,154,154,154,154,154,153,153,152,152,152,152,152,153,153,154,154,154,154,154,154,153,152,150,147,145,141,137,133,128,123,118,112,107,102,97,92,88,84,81,79,78,78,78,79,81,84,88,92,97},//up to harmonic 2
+		{108,110,112,114,117,120,122,125,128,131,134,136,139,142,144,146,148,150,152,153,154,155,156,157,157,157,156,155,154,153,152,150,148,146,144,142,139,136,134,131,128,125,122,120,117,114,112,110,108,106,104,103,102,101,100,99,99,99,100,101,102,103,104,106}//up to harmonic 1
+	}
+};
@@ -16,32 +16,178 @@
 #define timermask 0x20 //bitmask for the length counter halt
 #define CPUCLOCK 1789773.0
 #define SAMPLERATE 8192 //8.192khz sample rate
-#define ANGLEPERSTEP 2 //equivalent to TRIGINT_ANGLES_PER_CYCLE/SAMPLERATE
-#define harmonics 6 //how many additions of sine do we want
 #define PI 3.14159
+#define BLEPPHASES 32 //places between two samples a step can start from
+#define BLEPTAPS 16 //samples a step is spread over, the output lags by half of this
+#define BLEPBUFSIZE 32 //has to be a power of 2 and more than BLEPTAPS
+#define BLEPCUTOFF 0.45 //where the kernel cuts off as a fraction of the sample rate
+#define DCCUTOFF 90.0 //hz, the highpass the nes puts on its output before it goes anywhere
 
+float blepkernel[BLEPPHASES][BLEPTAPS];//band limited impulse at each phase, summed into the output it is a band limited step
+uint8_t apuready;//1 once APUTablesInit has filled in the tables below
+float mixpulse[31];//nonlinear dac the pulses share, indexed by pulse1 + pulse2 from 0 to 30
+float mixtnd[203];//the one triangle, noise and dmc share, indexed by 3*triangle + 2*noise + dmc
+#define WAVETABLESIZE 512 //samples in one period of a wavetable, has to be a power of 2
+#define WAVETABLESHIFT 23 //32 take away log2 of WAVETABLESIZE, moves a phase down to a table index
+#define WAVETABLELEVELS 9 //level m has harmonics up to WAVETABLESIZE/2 >> m
+#define WAVETABLETRIANGLE 4 //which wavetable is the triangle, the ones before it are the pulse duty cycles
+
+const double dutycycles[4] = {1.0/8.0,1.0/4.0,1.0/2.0,3.0/4.0};
+const uint8_t lengthtable[32] = {10,254,20,2,40,4,80,6,160,8,60,10,14,12,26,14,12,16,24,18,48,20,96,22,192,24,72,26,16,28,32,30};//half frames a note lasts, picked by the top 5 bits of $4003
+const uint8_t dutysequences[4] = {0x40,0x60,0x78,0x9F};//what the 8 step sequencer puts out for each duty cycle, step 0 is bit 7
+#ifdef WAVETABLE_APU
+float wavetables[5][WAVETABLELEVELS][WAVETABLESIZE];//each duty cycle of the pulses then the triangle, band limited by level
+#endif
+struct blep{//steps waiting to come out of a channel
+	float buf[BLEPBUFSIZE];//change in the output at each sample to come
+	uint8_t pos;//where the next sample is in buf
+	float sum;//output so far
+};
 struct pulsegen{
 	uint8_t regs[4];
 	uint8_t lengthcount;
+	uint32_t phase;//how far through the period it is, 2^32 is a whole period with the high part first
+	uint32_t increment;//added to phase every sample, 0 when it cant be heard
+	uint32_t countdown;//cpu cycles until the timer runs out and the sequencer moves on
+	uint8_t step;//where the 8 step duty sequencer is
+	uint8_t output;//0 to 15 going into the mixer
+	uint8_t envstart;//set by a write to the top of the timer, the envelope restarts on the next quarter frame
+	uint8_t envdivider;
+	uint8_t envdecay;//envelope volume, counts down from 15
 };
 struct triangle{
 	uint8_t regs[4];
 	uint8_t phase; //4 bit phase ranges from 0 to 31
+	uint32_t wavephase;//how far through the period it is, 2^32 is a whole period
+	uint32_t increment;
+	uint32_t countdown;//cpu cycles until the timer runs out and phase moves on
+	uint8_t linear;//linear counter, the sequencer only moves while it and the length counter are above 0
+	uint8_t linearreload;
 	uint8_t lengthcount;
 };
 struct apu{
-	uint8_t ce;//channel enable and length counter
+	uint8_t ce;//channel enables from $4015, a channel plays while its bit is set and its length counter is above 0
 	uint8_t framecounter;//framecounter, not actually emulating it clock accurate just using it to count the 4 steps
-	float currangle;//current angle for the sine
+	uint32_t samplerate;//what the increments are worked out for, every APUSample is one sample at this rate
+	uint64_t cyclespersample;//cpu cycles in a sample, 32.32 fixed point
+	uint64_t cyclefrac;//part of a cycle left over from the samples so far, the low 32 bits
+	float mix;//what the mixer is putting out before band limiting
+	struct blep out;//steps in the mixed output waiting to come out
+	float dcin;//last sample into the highpass
+	float dcout;//last sample out of it
+	float dcpole;//how much of dcout carries over each sample, from DCCUTOFF and the sample rate
 	struct pulsegen pulse1;
 	struct pulsegen pulse2;
 	struct triangle tri;
 	
 };
+void BLEPInit(void){//fills in blepkernel
+	for (uint8_t ph = 0; ph < BLEPPHASES; ph++){
+		double sum = 0;
+		for (uint8_t k = 0; k < BLEPTAPS; k++){
+			double x = k + 1 - (double)ph / (BLEPPHASES - 1) - BLEPTAPS / 2;//samples from the middle of the step
+			double sinc = x == 0 ? 1.0 : sin(PI * 2 * BLEPCUTOFF * x) / (PI * 2 * BLEPCUTOFF * x);
+			double window = 0.42 + 0.5 * cos(PI * x / (BLEPTAPS / 2)) + 0.08 * cos(2 * PI * x / (BLEPTAPS / 2));//blackman
+			blepkernel[ph][k] = sinc * window;
+			sum += blepkernel[ph][k];
+		}
+		for (uint8_t k = 0; k < BLEPTAPS; k++){//each phase has to add up to exactly the step it makes
+			blepkernel[ph][k] /= sum;
+		}
+	}
+}
+void BLEPStep(struct blep* b, float delta, double when){
+	//adds a step of delta to the output when (0 to 1) of the way from the last sample to the one being made
+	const float* k = blepkernel[(uint8_t)(when * (BLEPPHASES - 1) + 0.5)];
+	for (uint8_t i = 0; i < BLEPTAPS; i++){
+		b->buf[(b->pos + i) & (BLEPBUFSIZE - 1)] += delta * k[i];
+	}
+}
+float BLEPRead(struct blep* b){//gives back the next output sample, BLEPTAPS/2 samples behind the steps going in
+	b->sum += b->buf[b->pos];
+	b->buf[b->pos] = 0;
+	b->pos = (b->pos + 1) & (BLEPBUFSIZE - 1);
+	return b->sum;
+}
+void MixerInit(void){//fills in the mixer tables from the formulas on http://wiki.nesdev.com/w/index.php/APU_Mixer
+	mixpulse[0] = 0;
+	for (uint8_t n = 1; n < 31; n++){
+		mixpulse[n] = 95.52 / (8128.0 / n + 100);
+	}
+	mixtnd[0] = 0;
+	for (uint8_t n = 1; n < 203; n++){
+		mixtnd[n] = 163.67 / (24329.0 / n + 100);
+	}
+}
+float APUMix(uint8_t pulse1, uint8_t pulse2, uint8_t triangle){//channel levels from 0 to 15 in, what the nes dac puts out comes back, 1 would be full scale
+	return mixpulse[pulse1 + pulse2] + mixtnd[3 * triangle];
+}
+uint8_t TriangleOutput(uint8_t phase){//the 32 step sequence goes 15 down to 0 then back up
+	return phase < 16 ? 15 - phase : phase - 16;
+}
+#ifdef WAVETABLE_APU
+void WavetableInit(void){
+	//adds up the harmonics of every wave once so playing one back is a lookup, the sigma factor keeps the ringing at the edges down
+	//the pulses are 1-duty high and -duty low and the triangle goes from -1/8 to 1/8, APUSample scales them up to the channel levels
+	float sines[WAVETABLESIZE];
+	for (uint16_t n = 0; n < WAVETABLESIZE; n++){
+		sines[n] = sin(2 * PI * n / WAVETABLESIZE);
+	}
+	for (uint8_t m = 0; m < WAVETABLELEVELS; m++){
+		uint16_t top = (WAVETABLESIZE / 2) >> m;
+		for (uint8_t w = 0; w < 5; w++){
+			for (uint16_t n = 0; n < WAVETABLESIZE; n++){
+				double sum = 0;
+				for (uint16_t h = 1; h <= top; h++){
+					double sigma = sin(PI * h / (top + 1)) / (PI * h / (top + 1));
+					if (w == WAVETABLETRIANGLE){//odd harmonics falling off with the square
+						if (h & 1){
+							sum += sigma * (h & 2 ? -1.0 : 1.0) * sines[(h * n) & (WAVETABLESIZE - 1)] / (h * h) * (8 / (PI * PI)) / 8;
+						}
+					}
+					else{//a sawtooth take away the same one delayed by the duty cycle
+						uint16_t delay = dutycycles[w] * WAVETABLESIZE;
+						sum += sigma * (sines[(h * n) & (WAVETABLESIZE - 1)] - sines[(h * (n - delay)) & (WAVETABLESIZE - 1)]) / (PI * h) / 4;
+					}
+				}
+				wavetables[w][m][n] = sum;
+			}
+		}
+	}
+}
+float WavetableRead(const float levels[WAVETABLELEVELS][WAVETABLESIZE], uint32_t increment, uint32_t phase){
+	//looks up phase in the level with as many harmonics as fit under nyquist when the phase goes up by increment each sample
+	uint8_t m = 0;
+	while (m < WAVETABLELEVELS - 1 && (uint64_t)increment * ((WAVETABLESIZE / 2) >> m) > 0x80000000){
+		m++;
+	}
+	const float* t = levels[m];
+	uint16_t i = phase >> WAVETABLESHIFT;
+	float frac = (phase & ((1 << WAVETABLESHIFT) - 1)) * (1.0f / (1 << WAVETABLESHIFT));
+	return t[i] + (t[(i + 1) & (WAVETABLESIZE - 1)] - t[i]) * frac;
+}
+#endif
+void APUTablesInit(void){
+	//builds every table the apus share, APUInit does it the first time if nothing has yet
+	//nothing guards it so anything running apus on more than one thread has to call it before the threads start
+	BLEPInit();
+	MixerInit();
+#ifdef WAVETABLE_APU
+	WavetableInit();
+#endif
+	apuready = 1;
+}
 void APUInit(struct apu *a){
 	a->ce = 0x0F;
 	a->framecounter = 0;
-	a->currangle = 0.0;
+	a->samplerate = SAMPLERATE;
+	a->cyclespersample = 0;
+	a->cyclefrac = 0;
+	a->dcout = 0.0;
+	a->dcpole = 0.0;
+	if (!apuready){
+		APUTablesInit();
+	}
 	for (uint8_t i = 0; i < 4; i++){
 		a->pulse1.regs[i] = 0;
 		a->pulse2.regs[i] = 0;
@@ -49,34 +195,120 @@ void APUInit(struct apu *a){
 		
 	}
 	a->tri.phase = 0;
+	a->tri.wavephase = 0;
+	a->tri.increment = 0;
+	a->tri.countdown = 0;
+	a->tri.linear = 0;
+	a->tri.linearreload = 0;
 	a->pulse1.lengthcount = 0;
 	a->pulse2.lengthcount = 0;
+	struct pulsegen* pulses[2] = {&a->pulse1,&a->pulse2};
+	for (uint8_t i = 0; i < 2; i++){
+		pulses[i]->phase = 0;
+		pulses[i]->increment = 0;
+		pulses[i]->countdown = 0;
+		pulses[i]->step = 0;
+		pulses[i]->output = 0;
+		pulses[i]->envstart = 0;
+		pulses[i]->envdivider = 0;
+		pulses[i]->envdecay = 0;
+	}
+	a->out.pos = 0;
+	for (uint8_t j = 0; j < BLEPBUFSIZE; j++){
+		a->out.buf[j] = 0.0;
+	}
 	a->tri.lengthcount = 0;
+	a->mix = APUMix(0,0,TriangleOutput(a->tri.phase));//the triangle starts on 15, start the output there too so there is no pop
+	a->out.sum = a->mix;
+	a->dcin = a->mix;
+}
+uint32_t APUIncrement(struct apu *a, const uint8_t* regs, uint8_t steps){
+	//phase per sample for a channel whose timer is in regs 2 and 3 and that takes steps*(t+1) cycles a period
+	//0 for timers too low to play and for anything at or over nyquist, which band limited comes out as nothing
+	uint16_t t = ((regs[3] & 0x07) << 8) + regs[2];//returns the timer
+	double f = CPUCLOCK/(steps* (t+1));//magic calculation im getting off of http://wiki.nesdev.com/w/index.php/APU_Misc
+	if (t < 8 || f * 2 >= a->samplerate){
+		return 0;
+	}
+	return f / a->samplerate * 4294967296.0;
+}
+void APUSetIncrements(struct apu *a){//for when the timers or the sample rate change
+	a->cyclespersample = CPUCLOCK / a->samplerate * 4294967296.0;
+	a->dcpole = exp(-2 * PI * DCCUTOFF / a->samplerate);
+	a->pulse1.increment = APUIncrement(a,a->pulse1.regs,16);
+	a->pulse2.increment = APUIncrement(a,a->pulse2.regs,16);
+	a->tri.increment = APUIncrement(a,a->tri.regs,32);//triangle is an octave lower than the pulse waves for the same t
+}
+void APUSampleRate(struct apu *a, uint32_t samplerate){
+	a->samplerate = samplerate;
+	APUSetIncrements(a);
 }
 void APUWrite(struct apu *a, uint8_t val, uint8_t reg){
 	if (reg < 4){//pulse wave generator 1
 		a->pulse1.regs[reg] = val;
 		if (reg == 3){
-			a->pulse1.lengthcount = (val>>3) & 0x1F;
+			if (a->ce & 0x01){//a disabled channel doesnt load its length counter
+				a->pulse1.lengthcount = lengthtable[val >> 3];
+			}
+			a->pulse1.step = 0;//writing the top of the timer restarts the sequencer
+			a->pulse1.envstart = 1;//and the envelope
 		}
 	}
 	else if (reg < 8){//pulse wave 2
 		a->pulse2.regs[reg - 4] = val;
 		if (reg == 7){
-			a->pulse2.lengthcount = (val>>3) & 0x1F;
+			if (a->ce & 0x02){//a disabled channel doesnt load its length counter
+				a->pulse2.lengthcount = lengthtable[val >> 3];
+			}
+			a->pulse2.step = 0;
+			a->pulse2.envstart = 1;
 		}
 	}
 	else if (reg < 0x0C){//triangle generator
 		a->tri.regs[reg-8] = val;
+		if (reg == 0x0B){
+			if (a->ce & 0x04){//a disabled channel doesnt load its length counter
+				a->tri.lengthcount = lengthtable[val >> 3];
+			}
+			a->tri.linearreload = 1;
+		}
 	}
-	else if (reg == 0x15){//channel enable and elngth counter
+	else if (reg == 0x15){//channel enable, turning a channel off also clears its length counter
 		a->ce = val;
+		if (!(val & 0x01)){a->pulse1.lengthcount = 0;}
+		if (!(val & 0x02)){a->pulse2.lengthcount = 0;}
+		if (!(val & 0x04)){a->tri.lengthcount = 0;}
 	}
 	else if (reg == 0x017){//frame counter
 		a->framecounter = val;
 	}
+	if (reg < 0x0C && (reg & 0x03) >= 2){//a timer changed, this is the only time the division happens
+		APUSetIncrements(a);
+	}
 }
 
+void EnvelopeStep(struct pulsegen* p){//one quarter frame of a pulse's envelope
+	if (p->envstart){
+		p->envstart = 0;
+		p->envdecay = 15;
+		p->envdivider = p->regs[0] & 0x0F;
+	}
+	else if (p->envdivider){
+		p->envdivider--;
+	}
+	else{
+		p->envdivider = p->regs[0] & 0x0F;
+		if (p->envdecay){
+			p->envdecay--;
+		}
+		else if (p->regs[0] & 0x20){//the length counter halt flag loops the envelope
+			p->envdecay = 15;
+		}
+	}
+}
+uint8_t PulseVolume(const struct pulsegen* p){//constant volume or wherever the envelope has got to
+	return p->regs[0] & 0x10 ? p->regs[0] & 0x0F : p->envdecay;
+}
 void APUFrameStep(struct apu *a){//should be run at 240hz clock
 	if (a->framecounter == 0x03){a->framecounter= 0;}//after the 4th step we loop back to 0
 	else{a->framecounter++;}//increment frame counter
@@ -84,161 +316,135 @@ void APUFrameStep(struct apu *a){//should be run at 240hz clock
 		//clock length counters and sweep units
 		if (!(a->pulse1.regs[0] & 0x20)){//if couter isnt halted
 			if (a->pulse1.lengthcount > 0){
-					a->pulse1.lengthcount--;
-					if (!(a->pulse1.lengthcount)){
-						a->ce = a->ce & 0xFE;
-					}
-				}
+				a->pulse1.lengthcount--;
+			}
 		}
 		if (!(a->pulse2.regs[0] & 0x20)){//if couter isnt halted
 			if (a->pulse2.lengthcount > 0){
-					a->pulse2.lengthcount--;
-					if (!(a->pulse2.lengthcount)){
-						a->ce = a->ce & 0xFD;
-					}
-				}
+				a->pulse2.lengthcount--;
+			}
+		}
+		if (!(a->tri.regs[0] & 0x80)){//the triangle keeps its halt flag in the top bit
+			if (a->tri.lengthcount > 0){
+				a->tri.lengthcount--;
+			}
 		}
 	}
-		
+	//clock envelopes and triangle linear counter
+	EnvelopeStep(&a->pulse1);
+	EnvelopeStep(&a->pulse2);
+	if (a->tri.linearreload){
+		a->tri.linear = a->tri.regs[0] & 0x7F;
+	}
+	else if (a->tri.linear){
+		a->tri.linear--;
+	}
+	if (!(a->tri.regs[0] & 0x80)){
+		a->tri.linearreload = 0;
+	}
+}
+uint8_t APUStatus(struct apu *a){//what reading $4015 gives, a bit for each channel whose length counter is above 0
+	return (a->pulse1.lengthcount ? 0x01 : 0) | (a->pulse2.lengthcount ? 0x02 : 0) | (a->tri.lengthcount ? 0x04 : 0);
 }
-float approxsin(float t){
-	float j = t*.15915;
-	j = j - (int)j;
-	return 20.785 * j * (j - 0.5) * (j - 1.0f); 
+uint8_t APUSilent(struct apu *a){//1 if the registers say no channel can be making sound right now
+	//a channel is quiet when its length counter is at 0 (which is also what disabling it does),
+	//its timer is too low to play, for the pulses when the volume is at 0 and for the triangle when its linear counter ran out
+	uint8_t p1 = a->pulse1.lengthcount && (((a->pulse1.regs[3] & 0x07) << 8) + a->pulse1.regs[2]) >= 8 && PulseVolume(&a->pulse1);
+	uint8_t p2 = a->pulse2.lengthcount && (((a->pulse2.regs[3] & 0x07) << 8) + a->pulse2.regs[2]) >= 8 && PulseVolume(&a->pulse2);
+	uint8_t tri = a->tri.lengthcount && (((a->tri.regs[3] & 0x07) << 8) + a->tri.regs[2]) >= 8 && a->tri.linear;
+	return !(p1 || p2 || tri);
 }
-float SampleAPUSquare1(struct apu *a, double sampleTime){
-	if (!(a->ce & 0x01)){
+#ifdef WAVETABLE_APU
+float SampleAPUSquare(struct pulsegen* p, uint8_t enabled){//moves a pulse channel on a sample and reads its wavetable
+	if (!enabled || !p->increment){
 		return 0.0;
 	}
-	uint16_t t = ((a->pulse1.regs[3] & 0x07) << 8) + a->pulse1.regs[2];//returns the timer
-	uint8_t duty = (a->pulse1.regs[0] >> 6) & 0x03;
-	double dutycycle;
-	switch (duty){
-		case 0x00:
-			dutycycle = 1.0/8.0;
-			break;
-		case 0x01:
-			dutycycle = 1.0/4.0;
-			break;
-		case 0x02:
-			dutycycle = 1.0/2.0;
-			break;
-		case 0x03:
-			dutycycle = 3.0/4.0;
-			break;
-		default:
-			dutycycle = .5;
-			break;
-	}
-	dutycycle = dutycycle * 2 * PI;
-	if (t < 8){return 0.0;}
-	float f = CPUCLOCK/(16* (t+1));//magic calculation im getting off of http://wiki.nesdev.com/w/index.php/APU_Misc
-	//printf("frequency sample square 1: %f , duty cycle: %f \n", f, dutycycle);
-	float amp = 0.0;
-	float a1 = 0;
-	float b = 0;
-	for (uint8_t i = 1; i <= harmonics; i++){
-		double c = i*f*2.0*PI*sampleTime;
-		a1 += (sin(c)/i)/4.0;
-		b += (sin(c - dutycycle*i)/i)/4.0;
-	}
-	amp = (2.0/PI)* (a1 - b);
-	return amp;
-}
-float SampleAPUSquare2(struct apu *a, double sampleTime){
-	if (!(a->ce & 0x02)){
+	p->phase += p->increment;
+	return WavetableRead(wavetables[(p->regs[0] >> 6) & 0x03],p->increment,p->phase);
+}
+float SampleAPUTriangleWave(struct triangle* tr, uint8_t enabled){
+	if (!enabled || !tr->increment){
 		return 0.0;
 	}
-	uint16_t t = ((a->pulse2.regs[3] & 0x07) << 8) + a->pulse2.regs[2];//returns the timer
-	uint8_t duty = (a->pulse2.regs[0] >> 6) & 0x03;
-	double dutycycle;
-	switch (duty){
-		case 0x00:
-			dutycycle = 1.0/8.0;
-			break;
-		case 0x01:
-			dutycycle = 1.0/4.0;
-			break;
-		case 0x02:
-			dutycycle = 1.0/2.0;
-			break;
-		case 0x03:
-			dutycycle = 3.0/4.0;
-			break;
-		default:
-			dutycycle = .5;
-			break;
-	}
-	dutycycle = dutycycle * 2 * PI;
-	if (t < 8){return 0.0;}
-	float f = CPUCLOCK/(16* (t+1));//magic calculation im getting off of http://wiki.nesdev.com/w/index.php/APU_Misc
-	//printf("frequency sample square 2: %f , duty cycle: %f \n", f, dutycycle);
-	float amp = 0.0;
-	float a1 = 0;
-	float b = 0;
-	for (uint8_t i = 1; i <= harmonics; i++){
-		double c = i*f*2.0*PI*sampleTime;
-		a1 += (sin(c)/i)/4.0;
-		b += (sin(c - dutycycle*i)/i)/4.0;
-	}
-	amp = (2.0/PI)* (a1 - b);
-	return amp;
-}
-uint8_t SampleAPUTriangle(struct apu *a, double sampleTime){
-	uint16_t t = ((a->tri.regs[3] & 0x07) << 8) + a->tri.regs[2];//returns the timer
-	if (!(a->ce & 0x04)){
-		return 0;
+	tr->wavephase += tr->increment;
+	return WavetableRead(wavetables[WAVETABLETRIANGLE],tr->increment,tr->wavephase);
+}
+#else
+void APUMixStep(struct apu* a, double when){
+	//remixes after a channel changed its output, the difference goes into the output as a band limited step when (0 to 1) into the sample
+	//the channels run one after another so a change sees the others where they end the sample, the steps still add up to the right level
+	float mix = APUMix(a->pulse1.output,a->pulse2.output,TriangleOutput(a->tri.phase));
+	if (mix != a->mix){
+		BLEPStep(&a->out,mix - a->mix,when);
+		a->mix = mix;
+	}
+}
+void RunAPUSquare(struct apu* a, struct pulsegen* p, uint8_t enabled, uint32_t cycles){
+	//runs a pulse channel's timer and 8 step duty sequencer through the cpu cycles in this sample in one go,
+	//remixing wherever its output changes so the cost goes with how many steps there were
+	uint16_t t = ((p->regs[3] & 0x07) << 8) + p->regs[2];//returns the timer
+	uint8_t d = (p->regs[0] >> 6) & 0x03;
+	uint8_t volume = enabled && t >= 8 ? PulseVolume(p) : 0;
+	uint8_t output = dutysequences[d] & (0x80 >> p->step) ? volume : 0;
+	if (output != p->output){//registers or the envelope changed, or it just came on or went off
+		p->output = output;
+		APUMixStep(a,0);
 	}
-	if (t < 8){return 0.0;}
-	//printf("triangle t val: %d\n", t);
-	float f = CPUCLOCK/(16* (t+1));//magic calculation im getting off of http://wiki.nesdev.com/w/index.php/APU_Misc
-	f = f/2.0; //triangle is an octave lower than the pulse waves for the same t 
-	//printf("frequency sample triangle: %f \n", f);
-	float phase = sampleTime * 2 * PI * f;
-	phase = fmod(phase,2*PI);
-	phase = phase / (2*PI);
-	uint8_t sample = 0;
-	if (phase < .5){//first half of triangle
-		sample = 32*phase;
+	if (!enabled || t < 8){
+		return;
 	}
-	else{//second half of triangle
-		sample = 32*(1.0-phase);
+	uint32_t period = (t + 1) * 2;//the timer counts apu cycles, one every other cpu cycle
+	uint32_t at = 0;//cycles into this sample
+	while (p->countdown <= cycles - at){
+		at += p->countdown;
+		p->countdown = period;//a new period only gets picked up when the timer reloads
+		p->step = (p->step + 1) & 0x07;
+		output = dutysequences[d] & (0x80 >> p->step) ? volume : 0;
+		if (output != p->output){
+			p->output = output;
+			APUMixStep(a,(double)at / cycles);
+		}
 	}
-	sample = sample + (128 - 16);//offset to 128 - half of the peak to peak
+	p->countdown -= cycles - at;
 }
-
-uint8_t NaiveSampleSquare(struct apu* a, double sampleTime){
-	uint16_t t = ((a->pulse1.regs[3] & 0x07) << 8) + a->pulse1.regs[2];//returns the timer
-	uint8_t duty = (a->pulse1.regs[0] >> 6) & 0x03;
-	double dutycycle;
-	switch (duty){
-		case 0x00:
-			dutycycle = 1.0/8.0;
-			break;
-		case 0x01:
-			dutycycle = 1.0/4.0;
-			break;
-		case 0x02:
-			dutycycle = 1.0/2.0;
-			break;
-		case 0x03:
-			dutycycle = 3.0/4.0;
-			break;
-		default:
-			dutycycle = .5;
-			break;
-	}
-	dutycycle = dutycycle * 2 * PI;
-	if (t < 8){return 0.0;}
-	float f = CPUCLOCK/(16* (t+1));//magic calculation im getting off of http://wiki.nesdev.com/w/index.php/APU_Misc
-	//printf("frequency sample: %f , duty cycle: %f \n", f, dutycycle);
-	float angle = f*sampleTime*2*PI;
-	angle = fmod(angle,2*PI);
-	if (angle < dutycycle){
-		return 0xFF;
+void RunAPUTriangle(struct apu* a, uint8_t enabled, uint32_t cycles){
+	//same as the pulses with the timer counting cpu cycles and a 32 step sequencer, when the channel is off or too
+	//high to hear the sequencer stops where it is and the output holds there like it does on the real thing
+	struct triangle* tr = &a->tri;
+	uint16_t t = ((tr->regs[3] & 0x07) << 8) + tr->regs[2];//returns the timer
+	if (!enabled || !tr->linear || t < 2){
+		return;
 	}
-	else{
-		return 0x00;
+	uint32_t at = 0;
+	while (tr->countdown <= cycles - at){
+		at += tr->countdown;
+		tr->countdown = t + 1;
+		tr->phase = (tr->phase + 1) & 0x1F;
+		APUMixStep(a,(double)at / cycles);
 	}
+	tr->countdown -= cycles - at;
+}
+#endif
+float APUSample(struct apu *a){//mixes the channels into the next sample from 0 to 1, silence is at .5
+#ifdef WAVETABLE_APU
+	//the wavetables are band limited floats rather than levels so they go through the straight line the mixer tables are close to,
+	//a pulse's table is 1/4 of its level and the triangle's is 1/60
+	float mixed = (SampleAPUSquare(&a->pulse1,a->pulse1.lengthcount) * PulseVolume(&a->pulse1) + SampleAPUSquare(&a->pulse2,a->pulse2.lengthcount) * PulseVolume(&a->pulse2)) * 4 * 0.00752;
+	mixed += SampleAPUTriangleWave(&a->tri,a->tri.lengthcount && a->tri.linear) * 60 * 0.00851;
+#else
+	a->cyclefrac += a->cyclespersample;//whole cycles this sample covers, the fraction carries on to the next one
+	uint32_t cycles = a->cyclefrac >> 32;
+	a->cyclefrac &= 0xFFFFFFFF;
+	RunAPUSquare(a,&a->pulse1,a->pulse1.lengthcount,cycles);//a channel that is off has had its length counter cleared
+	RunAPUSquare(a,&a->pulse2,a->pulse2.lengthcount,cycles);
+	RunAPUTriangle(a,a->tri.lengthcount,cycles);
+	float mixed = BLEPRead(&a->out);
+#endif
+	a->dcout = mixed - a->dcin + a->dcpole * a->dcout;//highpass, so whatever level the channels stop on fades back to .5
+	a->dcin = mixed;
+	float samplerec = .5 + a->dcout;
+	if (samplerec > 1.0){samplerec = 1.0;}
+	if (samplerec < 0.0){samplerec = 0.0;}
+	return samplerec;
 }
 #endif /* APU_H_ */
\ No newline at end of file
@@ -0,0 +1,202 @@
+/*
+ * apulog.h
+ *
+ * records every apu register write of a song with its time so the song can be played again
+ * straight into an apu with no 6502 running, like a vgm file
+ * a log is the apu as it was when play calls started followed by the writes, each one
+ * the cycles since the one before as a 7 bit varint then the register then the value
+ * times are in cpu cycles from the first play call, a write is stamped with the cycle its
+ * instruction started on so a log plays back the same at any sample rate, the last event is an end marker
+ */
+
+
+#ifndef APULOG_H_
+#define APULOG_H_
+#include "apu.h"
+#include <stdlib.h>
+#define APULOGVERSION 4
+#define APULOGHEADER 31 //magic, version and the starting apu
+#define APULOGEND 0xFF //register number of the end marker
+#define APULOGFRAMESPERSECOND 240 //same as FRAMECOUNTERSPERSECOND in player.h
+
+struct apulog{
+	uint8_t* data;
+	uint32_t size;
+	uint32_t capacity;
+	uint64_t start;//cpu time of the first play call
+	uint64_t last;//time of the last event, from start
+	uint8_t failed;//1 if it ran out of memory, whatever got recorded is dropped
+};
+
+void APULogByte(struct apulog* l, uint8_t val){
+	if (l->failed){
+		return;
+	}
+	if (l->size == l->capacity){
+		uint32_t cap = l->capacity ? l->capacity * 2 : 0x1000;
+		uint8_t* grown = (uint8_t*)realloc(l->data,cap);
+		if (!grown){
+			l->failed = 1;
+			return;
+		}
+		l->data = grown;
+		l->capacity = cap;
+	}
+	l->data[l->size++] = val;
+}
+
+void APULogStart(struct apulog* l, const struct apu* a, uint64_t start){
+	//call when play calls start, a is saved as it is so the writes init made dont need to be in the log
+	l->data = NULL;
+	l->size = 0;
+	l->capacity = 0;
+	l->start = start;
+	l->last = 0;
+	l->failed = 0;
+	const uint8_t head[APULOGHEADER] = {'A','P','U','L',APULOGVERSION,a->ce,a->framecounter,
+		a->pulse1.regs[0],a->pulse1.regs[1],a->pulse1.regs[2],a->pulse1.regs[3],a->pulse1.lengthcount,
+		a->pulse2.regs[0],a->pulse2.regs[1],a->pulse2.regs[2],a->pulse2.regs[3],a->pulse2.lengthcount,
+		a->tri.regs[0],a->tri.regs[1],a->tri.regs[2],a->tri.regs[3],a->tri.phase,a->tri.lengthcount,
+		a->pulse1.envstart,a->pulse1.envdivider,a->pulse1.envdecay,a->pulse2.envstart,a->pulse2.envdivider,a->pulse2.envdecay,
+		a->tri.linear,a->tri.linearreload};
+	for (uint8_t i = 0; i < APULOGHEADER; i++){
+		APULogByte(l,head[i]);
+	}
+}
+
+void APULogEvent(struct apulog* l, uint64_t time, uint8_t reg, uint8_t val){
+	uint64_t t = time > l->start ? time - l->start : 0;
+	uint64_t delta = t > l->last ? t - l->last : 0;
+	l->last += delta;
+	while (delta >= 0x80){//low bits first, the top bit says more follow
+		APULogByte(l,(delta & 0x7F) | 0x80);
+		delta >>= 7;
+	}
+	APULogByte(l,delta);
+	APULogByte(l,reg);
+	APULogByte(l,val);
+}
+
+void APULogFinish(struct apulog* l, uint64_t time){//marks where the recording stops
+	APULogEvent(l,time,APULOGEND,0);
+}
+
+void APULogFree(struct apulog* l){
+	free(l->data);
+	l->data = NULL;
+	l->size = 0;
+	l->capacity = 0;
+}
+
+uint8_t APULogSave(const struct apulog* l, const char* path){//returns 1 if it couldnt
+	FILE* f = l->failed ? NULL : fopen(path,"wb");
+	if (!f){
+		return 1;
+	}
+	uint8_t failed = fwrite(l->data,1,l->size,f) != l->size;
+	return fclose(f) || failed;
+}
+
+struct apulogplayer{
+	struct apu a;
+	const uint8_t* data;
+	uint32_t size;
+	uint32_t pos;//next event
+	uint64_t nextevent;//time of the event at pos
+	uint64_t now;
+	uint32_t samplerate;
+	uint64_t nextframe;
+	uint64_t nextsample;
+	uint64_t samples;
+	uint64_t frames;
+	uint8_t done;//1 once the end marker has been reached
+};
+
+uint64_t APULogDelta(struct apulogplayer* lp){//reads the varint at pos
+	uint64_t delta = 0;
+	uint8_t shift = 0;
+	while (lp->pos < lp->size && shift < 64){
+		uint8_t b = lp->data[lp->pos++];
+		delta |= (uint64_t)(b & 0x7F) << shift;
+		shift += 7;
+		if (!(b & 0x80)){
+			break;
+		}
+	}
+	return delta;
+}
+
+uint8_t APULogPlayerInit(struct apulogplayer* lp, const uint8_t* data, uint32_t size, uint32_t samplerate){
+	//returns 1 if data isnt a log this version can play
+	if (size < APULOGHEADER || data[0] != 'A' || data[1] != 'P' || data[2] != 'U' || data[3] != 'L' || data[4] != APULOGVERSION){
+		return 1;
+	}
+	struct apu* a = &lp->a;
+	APUInit(a);
+	a->ce = data[5];
+	a->framecounter = data[6];
+	for (uint8_t i = 0; i < 4; i++){
+		a->pulse1.regs[i] = data[7 + i];
+		a->pulse2.regs[i] = data[12 + i];
+		a->tri.regs[i] = data[17 + i];
+	}
+	a->pulse1.lengthcount = data[11];
+	a->pulse2.lengthcount = data[16];
+	a->tri.phase = data[21];
+	a->tri.lengthcount = data[22];
+	struct pulsegen* pulses[2] = {&a->pulse1,&a->pulse2};
+	for (uint8_t i = 0; i < 2; i++){
+		pulses[i]->envstart = data[23 + i * 3];
+		pulses[i]->envdivider = data[24 + i * 3];
+		pulses[i]->envdecay = data[25 + i * 3];
+	}
+	a->tri.linear = data[29];
+	a->tri.linearreload = data[30];
+	a->mix = APUMix(0,0,TriangleOutput(a->tri.phase));//the output starts where the triangle is, like APUInit does
+	a->out.sum = a->mix;
+	a->dcin = a->mix;
+	APUSampleRate(a,samplerate);
+	lp->data = data;
+	lp->size = size;
+	lp->pos = APULOGHEADER;
+	lp->now = 0;
+	lp->samplerate = samplerate;
+	lp->nextframe = 0;
+	lp->nextsample = 0;
+	lp->samples = 0;
+	lp->frames = 0;
+	lp->done = 0;
+	lp->nextevent = APULogDelta(lp);
+	return 0;
+}
+
+float APULogPlayerSample(struct apulogplayer* lp){
+	//same schedule as PlayerSample with the writes coming out of the log instead of the cpu, gives back a sample from 0 to 1
+	while (1){
+		uint64_t next = lp->nextframe < lp->nextsample ? lp->nextframe : lp->nextsample;
+		lp->now = next;
+		while (!lp->done && lp->nextevent <= lp->now){//writes from before a time all land before what happens at it
+			if (lp->pos + 2 > lp->size || lp->data[lp->pos] == APULOGEND){
+				lp->done = 1;
+				break;
+			}
+			if (lp->nextevent == lp->now){//an instruction starting on now runs after it, same as RunCycles does
+				break;
+			}
+			APUWrite(&lp->a,lp->data[lp->pos + 1],lp->data[lp->pos]);
+			lp->pos += 2;
+			lp->nextevent += APULogDelta(lp);
+		}
+		if (lp->now == lp->nextframe){
+			APUFrameStep(&lp->a);
+			lp->frames++;
+			lp->nextframe = (uint64_t)(lp->frames * CPUCLOCK / APULOGFRAMESPERSECOND);
+		}
+		if (lp->now == lp->nextsample){
+			lp->samples++;
+			lp->nextsample = (uint64_t)(lp->samples * CPUCLOCK / lp->samplerate);
+			return APUSample(&lp->a);
+		}
+	}
+}
+#endif /* APULOG_H_ */
@@ -0,0 +1,225 @@
+/*
+ * bench.c
+ *
+ * times the cpu engine it is built with (make bench ENGINE=...) and prints the results as json
+ * usage: bench [file.nsf ...]
+ * every official opcode and addressing mode gets a synthetic play routine that runs it in a loop,
+ * then each nsf given runs BENCHFRAMES play calls of its starting song
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "cpu.h"
+#define BENCHCOPIES 16 //copies of the instruction in the loop body
+#define BENCHITERATIONS 250 //times round the loop in one play call
+#define BENCHPLAYS 200 //play calls timed for each opcode
+#define BENCHFRAMES 3600 //play calls timed for each nsf, a minute of music
+#define BENCHMAXCYCLES 1000000 //a play call that runs longer than this is cut off
+#define BENCHIMAGESIZE 0x1000
+
+double BenchSeconds(void){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return t.tv_sec + t.tv_nsec * .000000001;
+}
+
+uint64_t BenchCall(struct cpu* c, uint16_t addr){//runs one play or init call, gives back the cycles it took
+	uint64_t used = 0;
+	c->progcount = addr;
+	c->playing = 1;
+	while (c->playing && used < BENCHMAXCYCLES){
+		used += RunFor(c,BENCHMAXCYCLES);
+	}
+	c->playing = 0;
+	c->depth = 0;
+	c->s = 0xFF;
+	return used;
+}
+
+struct benchimage{//an nsf being put together in memory
+	uint8_t bytes[0x80 + BENCHIMAGESIZE];
+	uint16_t pc;//next address to emit at, the code loads at $8000
+};
+void BenchEmit(struct benchimage* b, uint8_t val){
+	b->bytes[0x80 + b->pc - 0x8000] = val;
+	b->pc++;
+}
+void BenchEmit3(struct benchimage* b, uint8_t op, uint16_t operand){
+	BenchEmit(b,op);
+	BenchEmit(b,operand & 0xFF);
+	BenchEmit(b,operand >> 8);
+}
+
+uint8_t BenchBody(uint8_t op){//how many instructions a copy of op needs, 0 for ones that arent timed on their own
+	if (op == 0x00 || op == 0x40 || op == 0x60 || op == 0x68 || op == 0x28){//brk and rti leave play, rts pla and plp come with their pair
+		return 0;
+	}
+	if (op == 0x20 || op == 0x48 || op == 0x08 || op == 0x9A){//jsr+rts, pha+pla, php+plp, tsx+txs
+		return 2;
+	}
+	return 1;
+}
+
+uint32_t BenchBuild(struct benchimage* b, uint8_t op){
+	//writes an nsf whose play routine runs op BENCHCOPIES times per loop, gives back the instructions per play call
+	//x and y are 1 and every operand points at $20-$23 or $0300 so nothing can reach the loop counter at $F0
+	const struct opcode* o = &opcodes[op];
+	for (uint32_t i = 0; i < sizeof(b->bytes); i++){
+		b->bytes[i] = 0;
+	}
+	b->bytes[0] = 'N'; b->bytes[1] = 'E'; b->bytes[2] = 'S'; b->bytes[3] = 'M'; b->bytes[4] = 0x1A;
+	b->bytes[5] = 1; b->bytes[6] = 1; b->bytes[7] = 1;
+	b->bytes[9] = 0x80;//loads at $8000
+	b->pc = 0x8000;
+	BenchEmit(b,0x60);//$8000 rts, the subroutine for jsr
+	uint16_t init = b->pc;
+	BenchEmit(b,0xA9); BenchEmit(b,0x00);//lda #0
+	BenchEmit(b,0x85); BenchEmit(b,0x21);//sta $21, ($20,x) with x=1 points at $0300
+	BenchEmit(b,0xA9); BenchEmit(b,0x03);//lda #3
+	BenchEmit(b,0x85); BenchEmit(b,0x22);//sta $22
+	BenchEmit(b,0x85); BenchEmit(b,0x23);//sta $23, ($22),y points at $0303
+	uint16_t pointers = b->pc;//jmp (ind) gets a pointer at $0310+2n to the copy after copy n, filled in below
+	if (op == 0x6C){
+		for (uint8_t i = 0; i < BENCHCOPIES; i++){
+			BenchEmit(b,0xA9); BenchEmit(b,0x00);
+			BenchEmit3(b,0x8D,0x0310 + i * 2);
+			BenchEmit(b,0xA9); BenchEmit(b,0x00);
+			BenchEmit3(b,0x8D,0x0311 + i * 2);
+		}
+	}
+	BenchEmit(b,0x60);//rts
+	uint16_t play = b->pc;
+	BenchEmit(b,0xA9); BenchEmit(b,BENCHITERATIONS);//lda #iterations
+	BenchEmit(b,0x85); BenchEmit(b,0xF0);//sta $f0
+	uint16_t loop = b->pc;
+	BenchEmit(b,0xA2); BenchEmit(b,0x01);//ldx #1
+	BenchEmit(b,0xA0); BenchEmit(b,0x01);//ldy #1
+	for (uint8_t i = 0; i < BENCHCOPIES; i++){
+		if (op == 0x48 || op == 0x08){//pha/php then pla/plp
+			BenchEmit(b,op);
+			BenchEmit(b,op + 0x20);
+		}
+		else if (op == 0x9A){
+			BenchEmit(b,0xBA);//tsx
+			BenchEmit(b,0x9A);
+		}
+		else if (op == 0x20){
+			BenchEmit3(b,0x20,0x8000);
+		}
+		else if (op == 0x4C){//jump to the next copy
+			BenchEmit3(b,0x4C,b->pc + 3);
+		}
+		else if (op == 0x6C){
+			uint16_t next = b->pc + 3;
+			b->bytes[0x80 + pointers + i * 10 + 1 - 0x8000] = next & 0xFF;
+			b->bytes[0x80 + pointers + i * 10 + 6 - 0x8000] = next >> 8;
+			BenchEmit3(b,0x6C,0x0310 + i * 2);
+		}
+		else{
+			BenchEmit(b,op);
+			switch (o->amode){
+				case AM_IMM: BenchEmit(b,0x01); break;
+				case AM_ZPG: case AM_ZPX: case AM_ZPY: BenchEmit(b,0x20); break;
+				case AM_IZX: BenchEmit(b,0x20); break;
+				case AM_IZY: BenchEmit(b,0x22); break;
+				case AM_REL: BenchEmit(b,0x00); break;//taken or not it ends up on the next copy
+				case AM_ABS: case AM_ABX: case AM_ABY: BenchEmit(b,0x00); BenchEmit(b,0x03); break;
+				default: break;
+			}
+		}
+	}
+	BenchEmit(b,0xC6); BenchEmit(b,0xF0);//dec $f0
+	BenchEmit(b,0xD0); BenchEmit(b,(uint8_t)(loop - (b->pc + 1)));//bne loop
+	BenchEmit(b,0x60);//rts
+	b->bytes[0x0A] = init & 0xFF; b->bytes[0x0B] = init >> 8;
+	b->bytes[0x0C] = play & 0xFF; b->bytes[0x0D] = play >> 8;
+	return 2 + BENCHITERATIONS * (2 + BENCHCOPIES * BenchBody(op) + 2) + 1;
+}
+
+uint8_t BenchRun(struct cpu* c, const struct rom* r, uint32_t plays, uint64_t* cycles, double* seconds){
+	//inits r's starting song then times plays play calls, returns 1 if init never finished
+	APUInit(&(c->a));
+	InitCpu(c);
+	LoadROM(c,r);
+	c->acc = r->startingsong ? r->startingsong - 1 : 0;
+	c->x = 0;
+	BenchCall(c,c->initadd);
+	if (c->clocks >= BENCHMAXCYCLES){
+		return 1;
+	}
+	uint64_t start = c->clocks;
+	double t = BenchSeconds();
+	for (uint32_t i = 0; i < plays; i++){
+		BenchCall(c,c->playadd);
+	}
+	*seconds = BenchSeconds() - t;
+	*cycles = c->clocks - start;
+	return 0;
+}
+
+int main(int argc, char** argv){
+	static struct cpu c;
+	static struct benchimage b;
+	static struct rom r;
+	uint64_t totalinst = 0;
+	double totalseconds = 0;
+	uint8_t failed = 0;
+	struct rom** songs = (struct rom**)calloc(argc,sizeof(struct rom*));//opened before any json goes out so a bad path cant leave half of it
+	if (!songs){
+		fprintf(stderr,"out of memory\n");
+		return 1;
+	}
+	for (int i = 1; i < argc; i++){
+		songs[i] = OpenROM(argv[i]);
+		if (!songs[i]){
+			for (int j = 1; j < i; j++){
+				CloseROM(songs[j]);
+			}
+			free(songs);
+			return 1;
+		}
+	}
+	printf("{\n\t\"engine\": \"%s\",\n\t\"opcodes\": [",ENGINENAME);
+	uint8_t first = 1;
+	for (uint16_t op = 0; op < 0x100; op++){
+		if (opnames[op * 3] == '-' || !BenchBody(op)){
+			continue;
+		}
+		uint64_t perplay = BenchBuild(&b,op);
+		uint64_t cycles;
+		double seconds;
+		InitROM(&r,b.bytes,sizeof(b.bytes));
+		if (BenchRun(&c,&r,BENCHPLAYS,&cycles,&seconds)){
+			FreeCpu(&c);//InitCpu doesnt free what the last one had, so the engine caches would leak
+			continue;
+		}
+		totalinst += perplay * BENCHPLAYS;
+		totalseconds += seconds;
+		printf("%s\n\t\t{\"opcode\": \"%02X\", \"name\": \"%.3s%s%s\", \"mode\": \"%s\", \"minstructions_per_second\": %.2f, \"mcycles_per_second\": %.2f}",
+			first ? "" : ",",op,&opnames[op * 3],BenchBody(op) == 2 ? "+" : "",BenchBody(op) == 2 ? (op == 0x20 ? "RTS" : op == 0x9A ? "TSX" : op == 0x48 ? "PLA" : "PLP") : "",
+			amodenames[opcodes[op].amode],perplay * BENCHPLAYS / seconds / 1000000.0,cycles / seconds / 1000000.0);
+		first = 0;
+		FreeCpu(&c);
+	}
+	printf("\n\t],\n\t\"opcodes_minstructions_per_second\": %.2f,\n\t\"nsfs\": [",totalinst / totalseconds / 1000000.0);
+	for (int i = 1; i < argc; i++){
+		uint64_t cycles;
+		double seconds;
+		if (!failed){//once one fails the rest are only closed, the json still gets finished
+			if (BenchRun(&c,songs[i],BENCHFRAMES,&cycles,&seconds)){
+				fprintf(stderr,"%s init never returned\n",argv[i]);
+				failed = 1;
+			}
+			else{
+				printf("%s\n\t\t{\"file\": \"%s\", \"play_calls\": %d, \"play_calls_per_second\": %.1f, \"mcycles_per_second\": %.2f}",
+					i == 1 ? "" : ",",argv[i],BENCHFRAMES,BENCHFRAMES / seconds,cycles / seconds / 1000000.0);
+			}
+			FreeCpu(&c);
+		}
+		CloseROM(songs[i]);
+	}
+	free(songs);
+	printf("\n\t]\n}\n");
+	return failed;
+}
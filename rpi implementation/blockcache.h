@@ -0,0 +1,159 @@
+/*
+ * blockcache.h
+ *
+ * block cache engine for cpu.h, built with -DBLOCKCACHE_CPU
+ * runs of instructions are decoded once into handler pointers with their operands
+ * already pulled out, and the play routine just replays them every frame
+ * immediate operands are read at decode time too and go to the Imm handlers below as the value itself
+ */
+
+
+#ifndef BLOCKCACHE_H_
+#define BLOCKCACHE_H_
+#define BLOCKCACHESIZE 1024 //number of blocks kept, has to be a power of 2
+#define BLOCKMAXLEN 32 //most instructions we put in one block
+
+struct decodedinst{
+	void (*exec)(struct cpu* c, uint16_t addr);
+	uint16_t addr;//the value for immediates, effective address when it only depends on the pc, raw operand otherwise
+	uint16_t pc;//address of the opcode
+	uint16_t next;//address of the instruction after this one
+	uint8_t amode;
+	uint8_t cycles;
+	uint8_t pagecross;
+};
+struct block{
+	uint16_t start;//pc the block was decoded from
+	uint8_t count;//0 if the slot was never used
+	uint32_t gen;//codegen at decode time, the block is stale once they differ
+	uint16_t banks;//bankswitch registers it was decoded under, see BlockBanks
+	struct decodedinst insts[BLOCKMAXLEN];
+};
+struct blockcache{
+	struct block blocks[BLOCKCACHESIZE];
+};
+
+//immediate versions of the handlers, addr is the operand value so nothing goes back to memory on a replay
+void ImmORA(struct cpu* c, uint16_t val){c->acc |= val; SetNZ(c,c->acc);}
+void ImmAND(struct cpu* c, uint16_t val){c->acc &= val; SetNZ(c,c->acc);}
+void ImmEOR(struct cpu* c, uint16_t val){c->acc ^= val; SetNZ(c,c->acc);}
+void ImmADC(struct cpu* c, uint16_t val){ADCFunction(c,val);}
+void ImmSBC(struct cpu* c, uint16_t val){ADCFunction(c,~val);}
+void ImmCMP(struct cpu* c, uint16_t val){CompareFunction(c,c->acc,val);}
+void ImmCPX(struct cpu* c, uint16_t val){CompareFunction(c,c->x,val);}
+void ImmCPY(struct cpu* c, uint16_t val){CompareFunction(c,c->y,val);}
+void ImmLDA(struct cpu* c, uint16_t val){c->acc = val; SetNZ(c,c->acc);}
+void ImmLDX(struct cpu* c, uint16_t val){c->x = val; SetNZ(c,c->x);}
+void ImmLDY(struct cpu* c, uint16_t val){c->y = val; SetNZ(c,c->y);}
+void (*ImmediateHandler(void (*exec)(struct cpu* c, uint16_t addr)))(struct cpu* c, uint16_t val){
+	//the Imm handler standing in for exec, NULL for ones that dont have one
+	if (exec == OpORA){return ImmORA;}
+	if (exec == OpAND){return ImmAND;}
+	if (exec == OpEOR){return ImmEOR;}
+	if (exec == OpADC){return ImmADC;}
+	if (exec == OpSBC){return ImmSBC;}
+	if (exec == OpCMP){return ImmCMP;}
+	if (exec == OpCPX){return ImmCPX;}
+	if (exec == OpCPY){return ImmCPY;}
+	if (exec == OpLDA){return ImmLDA;}
+	if (exec == OpLDX){return ImmLDX;}
+	if (exec == OpLDY){return ImmLDY;}
+	if (exec == OpNOP){return OpNOP;}//never looks at its operand anyway
+	return NULL;
+}
+
+uint8_t EndsBlock(uint8_t amode, void (*exec)(struct cpu* c, uint16_t addr)){
+	//branches, jumps and returns change the pc so nothing after them belongs to the block
+	return amode == AM_REL || exec == OpJMP || exec == OpJSR || exec == OpRTS || exec == OpRTI || exec == OpBRK;
+}
+
+uint16_t BlockBanks(struct cpu* c, uint16_t pc){
+	//a block is shorter than 4KB so it only runs through the bank at pc and the one after it
+	if (pc < 0x8000){//ram only matters to the key when a block near the top of it runs on into bank slot 0
+		return pc >= 0x7000 ? c->bankregs[0] << 8 : 0;
+	}
+	uint8_t slot = (pc >> 12) - 8;
+	return c->bankregs[slot] | (slot < 7 ? c->bankregs[slot + 1] << 8 : 0);
+}
+
+void DecodeBlock(struct cpu* c, struct block* b, uint16_t pc){
+	b->start = pc;
+	b->count = 0;
+	b->gen = c->codegen;
+	b->banks = BlockBanks(c,pc);
+	while (b->count < BLOCKMAXLEN){
+		const struct opcode* op = &opcodes[ReadMemory(c,pc)];
+		struct decodedinst* d = &b->insts[b->count];
+		uint16_t operand = (ReadMemory(c,pc+2) << 8) + ReadMemory(c,pc+1);
+		d->exec = op->exec;
+		d->amode = op->amode;
+		d->cycles = op->cycles;
+		d->pagecross = op->pagecross;
+		d->pc = pc;
+		d->next = pc + op->length;
+		switch (op->amode){
+			case AM_IMM:
+				if (ImmediateHandler(op->exec)){
+					d->exec = ImmediateHandler(op->exec);
+					d->addr = operand & 0xFF;
+				}
+				else{
+					d->addr = pc + 1;
+				}
+				break;
+			case AM_ZPG:
+				d->addr = operand & 0xFF;
+				break;
+			case AM_REL:
+				d->addr = pc + 2 + (int8_t)(operand & 0xFF);
+				break;
+			default://indexed and indirect modes get resolved when they run
+				d->addr = operand;
+				break;
+		}
+		MarkCodePage(c,pc);
+		MarkCodePage(c,pc + op->length - 1);
+		b->count++;
+		if (EndsBlock(op->amode,op->exec)){
+			break;
+		}
+		pc = d->next;
+	}
+}
+
+struct block* LookupBlock(struct cpu* c, uint16_t pc){
+	if (!c->blocks){
+		c->blocks = (struct blockcache*)calloc(1,sizeof(struct blockcache));
+	}
+	struct block* b = &c->blocks->blocks[pc & (BLOCKCACHESIZE-1)];
+	if (!b->count || b->start != pc || b->gen != c->codegen || b->banks != BlockBanks(c,pc)){
+		DecodeBlock(c,b,pc);
+	}
+	return b;
+}
+
+uint32_t RunForBlocks(struct cpu* c, uint32_t cycles){
+	//runs until at least cycles have been used or play/init returns, gives back the cycles used
+	uint32_t used = 0;
+	while (c->playing && used < cycles){
+		struct block* b = LookupBlock(c,c->progcount);
+		uint32_t gen = b->gen;
+		for (uint8_t i = 0; i < b->count; i++){
+			const struct decodedinst* d = &b->insts[i];
+			uint16_t addr = d->addr;
+			if (d->amode >= AM_ZPX && d->amode != AM_ABS && d->amode != AM_REL){//indexed and indirect modes
+				addr = ResolveAddress(c,d->amode,d->addr);
+			}
+			c->progcount = d->next;
+			c->extracycles = d->pagecross ? PageCrossed(addr,d->amode == AM_ABX ? c->x : c->y) : 0;
+			c->runused = used;
+			d->exec(c,addr);
+			used += d->cycles + c->extracycles;
+			if (!c->playing || used >= cycles || c->codegen != gen){//returned, out of time or the block got overwritten
+				break;
+			}
+		}
+	}
+	return used;
+}
+#endif /* BLOCKCACHE_H_ */
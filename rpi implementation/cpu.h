@@ -9,9 +9,14 @@
 #ifndef CPU_H_
 #define CPU_H_
 #include "apu.h"
+#include "apulog.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #define nbitpos 7
 #define vbitpos 6
 #define bbitpos 4
@@ -26,7 +31,6 @@
 #define READ 0x02 //this is the spi instruction to read an address from rpi
 #define WRITE 0x03 //this is the spi instruction to write to an address from rpi
 #define INITEMU 0x04 //this is the spi instruction to tell the rpi to init the emulation
-#define FUNCTIONBUFFSIZE 256 //size of the buffers for the init and play functions
 #define CFLAG 0
 #define ZFLAG 1
 #define IFLAG 2
@@ -39,10 +43,36 @@ enum CPUStatus {
 	waitrpi,
 	running
 	};
+struct rom{//an nsf file, mapped once read only and shared by every cpu playing it
+	const uint8_t* file;//the whole file
+	const uint8_t* data;//everything after the header
+	long filesize;
+	long size;//bytes of data
+	long edgeoff[2];//pages that only partly overlap the data, as offsets into it
+	uint8_t edge[2][0x100];//copies of those pages padded with 0
+	uint8_t zero[0x100];//for pages past either end of the data
+	uint16_t loadaddress;
+	uint16_t initadd;
+	uint16_t playadd;
+	uint16_t playspeed;
+	uint8_t totalsongs;
+	uint8_t startingsong;//counts from 1
+	uint8_t banked;//1 if the header asks for bankswitching
+	uint8_t initbanks[8];//banks in $8000-$FFFF before init runs
+	char songname[32];
+	char artistname[32];
+	char copyright[32];
+};
+struct cpu;
+typedef uint8_t (*readhandler)(struct cpu* c, uint16_t pos);//for pages that arent plain memory
+typedef void (*writehandler)(struct cpu* c, uint16_t pos, uint8_t val);
 struct cpu
 {
 	uint8_t s; //stack pointer
-	uint8_t status; //status register
+	uint8_t status; //status register, only I and D are kept here, N Z C and V are worked out from the fields below when read
+	uint16_t nzres; //last result byte, z is set when the low byte is 0 and n comes from bit 7 of either byte
+	uint16_t cres; //carry is bit 8, usually the unclipped result of the last add/shift/compare
+	uint8_t vres; //overflow is bit 7
 	/* bit of the status register in order starting from bit 7 down
 	N: negative flag set when any arithmetic ops give a negative
 	V: overflow flag set on a sign overflow on int8_tacter operations clear otherwsise
@@ -53,39 +83,102 @@ struct cpu
 	Z:  zero flag set when an arithmetic operation is loaded with the value 0 and clear otherwise
 	C: carry flag used in additions and subtractions as a 9th bit
 	*/
-	int8_t acc; //accumulator
+	uint8_t acc; //accumulator
 	uint8_t x; //indexing register x
 	uint8_t y; // indexing register y
 	uint8_t depth; //counts how many routines have been called
 	uint8_t playing; //1 if we are currently running the play routine
-	uint8_t startingsong;
 	uint8_t instbuffer[3]; //buffer for instructions read from spi
 	uint8_t RAM[ramsize];//2KB internal ram
-	uint8_t cart[0x1FFFF];
-	char songname[32];
-	char artistname[32];
-	char copyright[32];
-	uint8_t initbuff[FUNCTIONBUFFSIZE];//internal buffer for the init function
-	uint8_t playbuff[FUNCTIONBUFFSIZE];//internal buffer for the play function
+	uint8_t workram[0x2000];//$6000-$7FFF, everything above comes straight from the shared rom
+	const struct rom* rom;//the file being played
 	uint16_t progcount; // program counter
 	uint16_t playspeed;
 	uint16_t playadd;
 	uint16_t initadd;
 	
-	uint16_t clocks;
+	uint64_t clocks;//cycles of emulated time so far
+	uint64_t deadline;//where RunCycles has been asked to run up to
+	uint8_t extracycles;//page crossing and branch cycles of the instruction(s) being run
+	uint32_t runused;//cycles the running RunFor had used when the instruction (or jit block) being run started
+	uint32_t blockused;//jit only, base cycles into the running block where the instruction doing a write started
 	enum CPUStatus state;
 	struct apu a;
+	struct blockcache* blocks;//decoded blocks for the block cache engine, allocated on first use
+	struct jitcache* jit;//native code for the jit engine, allocated on first use
+	uint32_t codegen;//bumped whenever code that has been decoded gets written
+	uint8_t codepages[0x100];//nonzero for every page that decoded code was read from
+	uint8_t bankregs[8];//last values written to the $5FF8-$5FFF bank registers
+	struct apulog* log;//gets every apu write when set, NULL otherwise
+	struct trace* trace;//gets every instruction and write when set, NULL otherwise
+#ifdef PROFILE_CPU
+	struct profile* prof;//allocated on first use
+#endif
+	uint8_t dirtypages[0x100];//nonzero for every page written through WriteMemory since the loop finder last looked
+	const uint8_t* readmap[0x100];//host memory for each 256 byte page, NULL if reads go to readio
+	uint8_t* writemap[0x100];//same for writes, NULL if writes go to writeio
 };
+uint8_t FlagN(struct cpu* c){
+	return ((c->nzres | (c->nzres >> 8)) >> 7) & 0x01;
+}
+uint8_t FlagZ(struct cpu* c){
+	return !(c->nzres & 0xFF);
+}
+uint8_t FlagC(struct cpu* c){
+	return (c->cres >> 8) & 0x01;
+}
+uint8_t FlagV(struct cpu* c){
+	return (c->vres >> 7) & 0x01;
+}
+void SetNZFlags(struct cpu* c, uint8_t n, uint8_t z){
+	c->nzres = (n ? 0x8000 : 0x0000) | (z ? 0x00 : 0x01);
+}
 void SetPBit(struct cpu* tmp, uint8_t pos, uint8_t val){
-	if (val){
-		tmp->status |= ( 0x01 << pos);
-	}
-	else{
-		tmp->status &= ~(0x01 << pos);
+	switch (pos){
+		case NFLAG:
+			SetNZFlags(tmp,val,FlagZ(tmp));
+			break;
+		case ZFLAG:
+			SetNZFlags(tmp,FlagN(tmp),val);
+			break;
+		case CFLAG:
+			tmp->cres = val ? 0x100 : 0x000;
+			break;
+		case VFLAG:
+			tmp->vres = val ? 0x80 : 0x00;
+			break;
+		default:
+			if (val){
+				tmp->status |= ( 0x01 << pos);
+			}
+			else{
+				tmp->status &= ~(0x01 << pos);
+			}
+			break;
 	}
 }
 uint8_t GetPBit(struct cpu* c,uint8_t pos){
-	return ((c->status >> pos) & 0x01);
+	switch (pos){
+		case NFLAG:
+			return FlagN(c);
+		case ZFLAG:
+			return FlagZ(c);
+		case CFLAG:
+			return FlagC(c);
+		case VFLAG:
+			return FlagV(c);
+		default:
+			return ((c->status >> pos) & 0x01);
+	}
+}
+uint8_t GetStatus(struct cpu* c){//builds the whole status byte, without B and the unused bit
+	return c->status | (FlagN(c) << NFLAG) | (FlagV(c) << VFLAG) | (FlagZ(c) << ZFLAG) | (FlagC(c) << CFLAG);
+}
+void SetStatus(struct cpu* c, uint8_t val){
+	c->status = val & ((0x01 << IFLAG) | (0x01 << DFLAG));
+	SetNZFlags(c,val & (0x01 << NFLAG),val & (0x01 << ZFLAG));
+	c->cres = (val & (0x01 << CFLAG)) << 8;
+	c->vres = (val & (0x01 << VFLAG)) << 1;
 }
 void PushStack(struct cpu* c, uint8_t val){
 	c->s--;
@@ -93,100 +186,181 @@ void PushStack(struct cpu* c, uint8_t val){
 }
 uint8_t PopStack(struct cpu* c){
 	c->s++;
-	return c->RAM[c->s-1 + stackhead];
+	return c->RAM[(uint8_t)(c->s-1) + stackhead];//the stack wraps inside page 1
 }
 uint8_t PeekStack(struct cpu* c){
 	return c->RAM[c->s+stackhead];
 }
 
-void PopulateBuffers(struct cpu *c){//fills the play and init buffers so we dont have to spi so much
-	/*c->progcount = c->initadd;
-	for (uint8_t i = 0; i < 255;i++){
-		//SPI_Transmit(0xFF);//transmit dummy data so we know we arent ahead of the rpi
-		SPI_Transmit(READ);
-		SPI_Transmit((c->progcount >>8) & 0xFF);
-		SPI_Transmit(c->progcount & 0xFF);
-		SPI_Transmit(0xFF);//dummy data so we can get the requested information back on the next cycle
-		c->initbuff[i] = SPI_ServantReceive();
-		c->progcount+=1;
-	}//get the first 255 bytes for the init buffer
-	//SPI_Transmit(0xFF);//transmit dummy data so we know we arent ahead of the rpi
-	SPI_Transmit(READ);
-	SPI_Transmit((c->progcount >>8) & 0xFF);
-	SPI_Transmit(c->progcount & 0xFF);
-	SPI_Transmit(0xFF);//dummy data so we can get the requested information back on the next cycle
-	c->initbuff[255] = SPI_ServantReceive();//gets the last byte for the buffer
-	c->progcount = c->playadd;
-	for (uint8_t i = 0; i < 255;i++){
-		//SPI_Transmit(0xFF);//transmit dummy data so we know we arent ahead of the rpi
-		SPI_Transmit(READ);
-		SPI_Transmit((c->progcount >>8) & 0xFF);
-		SPI_Transmit(c->progcount & 0xFF);
-		SPI_Transmit(0xFF);//dummy data so we can get the requested information back on the next cycle
-		c->playbuff[i] = SPI_ServantReceive();
-		c->progcount+=1;
-	}//get the first 255 bytes for the play buffer
-	//SPI_Transmit(0xFF);//transmit dummy data so we know we arent ahead of the rpi
-	SPI_Transmit(READ);
-	SPI_Transmit((c->progcount >>8) & 0xFF);
-	SPI_Transmit(c->progcount & 0xFF);
-	SPI_Transmit(0xFF);//dummy data so we can get the requested information back on the next cycle
-	c->initbuff[255] = SPI_ServantReceive();//gets the last byte*/
-	FILE *fileptr;
-	uint8_t *buffer;
-	long filelen;
-	printf("before file read\n");
-	fileptr = fopen("smb.nsf", "rb");  // Open the file in binary mode
-	fseek(fileptr, 0, SEEK_END);          // Jump to the end of the file
-	filelen = ftell(fileptr);             // Get the current byte offset in the file
-	rewind(fileptr);                      // Jump back to the beginning of the file
+void CopyROMPage(struct rom* r, long off, uint8_t* dst){//copies 256 bytes of the data starting at off, 0 outside of it
+	for (uint16_t i = 0; i < 0x100; i++){
+		dst[i] = (off + i >= 0 && off + i < r->size) ? r->data[off + i] : 0;
+	}
+}
+uint8_t InitROM(struct rom* r, const uint8_t* buffer, long filelen){
+	//fills r in from an nsf that is already in memory and stays there, returns 1 if it isnt one
+	if (filelen < 0x80 || !(buffer[0] == 'N' && buffer[1] == 'E' && buffer[2] == 'S' && buffer[3] == 'M' && buffer[4] == 0x1A)){
+		return 1;
+	}
+	r->file = buffer;
+	r->filesize = filelen;
+	r->data = buffer + 0x80;
+	r->size = filelen - 0x80;
+	r->totalsongs = buffer[6];
+	r->startingsong = buffer[7];
+	r->loadaddress = buffer[8]+(buffer[9]<<8);
+	r->initadd = buffer[0x0A]+(buffer[0x0B]<<8);
+	r->playadd = buffer[0x0C]+(buffer[0x0D]<<8);
+	r->playspeed = buffer[0x6E]+(buffer[0x6F]<<8);//ntsc play rate in microseconds
+	r->banked = 0;
+	for (uint8_t i = 0; i < 8; i++){
+		r->initbanks[i] = buffer[0x70 + i];
+		r->banked |= r->initbanks[i] != 0;
+	}
+	for (unsigned char i = 0; i < 31; i++){//not every file terminates them so the last byte stays 0
+		r->songname[i] = buffer[0x0e +i];
+		r->artistname[i] = buffer[0x2e +i];
+		r->copyright[i] = buffer[0x4e +i];
+	}
+	r->songname[31] = 0;
+	r->artistname[31] = 0;
+	r->copyright[31] = 0;
+	//every page the cpu sees starts at the same offset mod 256, so at most the first and last can hang off the data
+	long misalign = r->loadaddress & 0xFF;
+	r->edgeoff[0] = -misalign;
+	r->edgeoff[1] = -misalign + ((r->size + misalign - 1) & ~0xFFL);
+	CopyROMPage(r,r->edgeoff[0],r->edge[0]);
+	CopyROMPage(r,r->edgeoff[1],r->edge[1]);
+	for (uint16_t i = 0; i < 0x100; i++){
+		r->zero[i] = 0;
+	}
+	return 0;
+}
+struct rom* OpenROM(const char* path){//maps an nsf file once so any number of cpus can use it, NULL if it couldnt
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st)){
+		fprintf(stderr,"could not open %s\n",path);
+		if (fd >= 0){close(fd);}
+		return NULL;
+	}
+	long filelen = st.st_size;
+	const uint8_t* buffer = filelen >= 0x80 ? (const uint8_t*)mmap(NULL, filelen, PROT_READ, MAP_PRIVATE, fd, 0) : (const uint8_t*)MAP_FAILED;
+	close(fd);//the mapping stays valid
+	struct rom* r = buffer != MAP_FAILED ? (struct rom*)calloc(1,sizeof(struct rom)) : NULL;
+	if (!r || InitROM(r,buffer,filelen)){
+		fprintf(stderr,"%s is not an nsf file\n",path);
+		if (buffer != MAP_FAILED){munmap((void*)buffer,filelen);}
+		free(r);
+		return NULL;
+	}
+	return r;
+}
+void CloseROM(struct rom* r){//only once no cpu is using it anymore, and only for ones from OpenROM
+	munmap((void*)r->file,r->filesize);
+	free(r);
+}
+const uint8_t* ROMPage(const struct rom* r, long off){//256 bytes of the data starting at off
+	if (off >= 0 && off + 0x100 <= r->size){
+		return r->data + off;//straight out of the mapped file
+	}
+	if (off == r->edgeoff[0]){
+		return r->edge[0];
+	}
+	if (off == r->edgeoff[1]){
+		return r->edge[1];
+	}
+	return r->zero;
+}
+void FlushCode(struct cpu* c){//throws away everything decoded from memory, used when code gets overwritten
+	for (uint16_t i = 0; i < 0x100; i++){
+		c->codepages[i] = 0;
+	}
+	c->codegen++;
+}
+void SwitchBank(struct cpu* c, uint8_t slot, uint8_t bank){//puts 4KB bank of the file at $8000 + slot*$1000
+	//banks count from the load address rounded down to 4KB, so only the 16 page pointers change and nothing gets copied
+	long off = bank * 0x1000L - (c->rom->loadaddress & 0xFFF);
+	for (uint8_t i = 0; i < 0x10; i++){
+		c->readmap[0x80 + (slot << 4) + i] = ROMPage(c->rom,off + (i << 8));
+	}
+}
+void LoadROM(struct cpu* c, const struct rom* r){//points this cpu's memory map at the rom
+	c->rom = r;
+	c->initadd = r->initadd;
+	c->playadd = r->playadd;
+	c->playspeed = r->playspeed;
+	if (r->banked){//nothing gets loaded under $8000 and the header says which banks to start with
+		for (uint8_t i = 0; i < 8; i++){
+			c->bankregs[i] = r->initbanks[i];
+			SwitchBank(c,i,r->initbanks[i]);
+		}
+		return;
+	}
+	for (uint16_t i = 0x60; i < 0x100; i++){
+		long off = (i << 8) - r->loadaddress;
+		if (i < 0x80){//anything loaded under $8000 is in work ram, which each cpu needs its own copy of
+			for (uint16_t j = 0; j < 0x100; j++){
+				c->workram[((i - 0x60) << 8) + j] = ROMPage(r,off)[j];
+			}
+		}
+		else{
+			c->readmap[i] = ROMPage(r,off);
+		}
+	}
+}
 
-	buffer = (char *)malloc((filelen+1)*sizeof(char)); // Enough memory for file + \0
-	fread(buffer, filelen, 1, fileptr); // Read in the entire file
-	fclose(fileptr); // Close the file
-	printf("after file read\n");
-	if (buffer[0] == 'N' && buffer[1] == 'E' && buffer[2] == 'S' && buffer[3] == 'M' && buffer[4] == 0x1A){
-		printf("file read works\n");
+uint8_t ReadIO(struct cpu* c, uint16_t pos){//$40xx
+	if (pos == 0x4015){
+		return APUStatus(&c->a);
+	}
+	return 0;
+}
+void WriteIO(struct cpu* c, uint16_t pos, uint8_t val){//$40xx
+	if (pos <= 0x4013 || pos == 0x4015){//apu write
+		APUWrite(&(c->a),val,pos & 0xFF);
+		if (c->log){//stamped with the cycle the writing instruction started on, clocks only moves on when RunFor returns
+			//extracycles is only ever nonzero here for the jit, where it holds the page crossings earlier in the block
+			APULogEvent(c->log,c->clocks + c->runused + c->blockused + c->extracycles,pos & 0xFF,val);
+		}
+	}
+}
+void WriteBankRegs(struct cpu* c, uint16_t pos, uint8_t val){//$5Fxx
+	if (pos >= 0x5FF8){
+		uint8_t slot = pos - 0x5FF8;
+		if (c->rom && c->rom->banked && c->bankregs[slot] != val){
+			SwitchBank(c,slot,val);
+			//blocks are checked against the banks when they start, but one already running out of the old bank has to stop
+			uint16_t running = c->progcount >= 0x8000 ? (c->progcount >> 12) - 8 : 0xFF;
+			if (slot == running || slot == running + 1){
+				FlushCode(c);
+			}
+		}
+		c->bankregs[slot] = val;
 	}
-	else{printf("file read does not works\n");exit(1);}
-	c->startingsong = buffer[7];
-	uint16_t loadaddress = buffer[8]+(buffer[9]<<8);
-	c->initadd = buffer[0x0A]+(buffer[0x0B]<<8);
-	c->playadd = buffer[0x0C]+(buffer[0x0D]<<8);
-	for (unsigned char i = 0; i < 32; i++){ 
-		c->songname[i] = buffer[0x0e +i];
-		c->artistname[i] = buffer[0x2e +i];
-		c->copyright[i] = buffer[0x4e +i];
+}
+//handlers for the pages that arent memory, the same for every cpu so they arent kept per instance
+//pages with neither memory nor a handler read as 0 and ignore writes
+const readhandler readio[0x100] = {[0x40] = ReadIO};
+const writehandler writeio[0x100] = {[0x40] = WriteIO, [0x5F] = WriteBankRegs};
+void MapMemory(struct cpu* c){//fills the page table, the rom pages stay unmapped until LoadROM
+	for (uint16_t i = 0; i < 0x100; i++){
+		c->readmap[i] = NULL;
+		c->writemap[i] = NULL;
 	}
-	printf("%d",loadaddress);
-	printf("\n");
-	printf("%d",c->initadd);
-	printf("\n");
-	printf("%d",c->playadd);
-	printf("\n");
-	printf(c->songname);
-	printf("\n");
-	printf(c->artistname);
-	printf("\n");
-	printf(c->copyright);
-	printf("\n");
-	for (unsigned int i = 0; i < filelen - 0x80; i++){
-		c->cart[loadaddress+i] = buffer[i+0x80];
-		//printf("\n");
+	for (uint16_t i = 0x00; i < 0x20; i++){//ram is mirrored 4 times
+		c->writemap[i] = &c->RAM[(i << 8) % ramsize];
+		c->readmap[i] = c->writemap[i];
 	}
-	for (unsigned int i = 0; i < 256; i++){
-		c->playbuff[i] = c->cart[c->playadd+i];
-		c->initbuff[i] = c->cart[c->initadd+i];
+	for (uint16_t i = 0x60; i < 0x80; i++){
+		c->writemap[i] = &c->workram[(i - 0x60) << 8];
+		c->readmap[i] = c->writemap[i];
 	}
-	printf("instruction at init: %d\n",c->cart[c->initadd]);
-	printf("instruction at play: %d\n",c->cart[c->playadd]);
-	printf("instruction at init: %d\n",c->cart[c->initadd]);
-	
 }
 
 void InitCpu(struct cpu* c){
 	c->s = 0xFF;//stack grows downwards
-	c->status = 0;
+	SetStatus(c,0);
 	c->depth = 0;
 	c->acc = 0;
 	c->playing = 0;
@@ -195,14 +369,15 @@ void InitCpu(struct cpu* c){
 	c->instbuffer[0]=0;
 	c->instbuffer[1]=0;
 	c->instbuffer[2]=0;
-	for (uint16_t i = 0; i < 0x07FF; i++){
+	c->rom = NULL;
+	MapMemory(c);
+	for (uint16_t i = 0; i < ramsize; i++){
 		c->RAM[i] = 0;
 	}
-	for (uint16_t i = 0x6000; i < 0x7FFF; i++){
-		c->cart[i] = 0;
+	for (uint16_t i = 0; i < 0x2000; i++){
+		c->workram[i] = 0;
 	}
-	
-	PopulateBuffers(c);
+
 	/*c->initadd = SPI_ServantReceive();
 	c->initadd += SPI_ServantReceive() << 8;
 	c->playadd = SPI_ServantReceive();
@@ -211,1630 +386,882 @@ void InitCpu(struct cpu* c){
 	c->playspeed += SPI_ServantReceive() << 8;
 	c->progcount = c->initadd;*/
 	c->clocks = 0;
+	c->deadline = 0;
+	c->extracycles = 0;
+	c->runused = 0;
+	c->blockused = 0;
 	c->state = running;
+	c->blocks = NULL;
+	c->jit = NULL;
+	c->codegen = 0;
+	c->log = NULL;
+	c->trace = NULL;
+#ifdef PROFILE_CPU
+	c->prof = NULL;
+#endif
+	for (uint8_t i = 0; i < 8; i++){
+		c->bankregs[i] = 0;
+	}
+	for (uint16_t i = 0; i < 0x100; i++){
+		c->codepages[i] = 0;
+		c->dirtypages[i] = 1;
+	}
 }
+#include "trace.h"
 uint8_t ReadMemory(struct cpu *c, uint16_t pos){
-	if (pos <= mirrorhead){
-		pos = pos % ramsize;
-		return c->RAM[pos];
-	}
-	else if (pos >= c->playadd && pos < c->playadd+256){
-		return c->playbuff[pos-c->playadd];	
+	const uint8_t* page = c->readmap[pos >> 8];
+	if (page){
+		return page[pos & 0xFF];
 	}
-	else if (pos >= c->initadd && pos < c->initadd+256){
-		return c->initbuff[pos-c->initadd];
+	if (readio[pos >> 8]){
+		return readio[pos >> 8](c,pos);
 	}
-	else if (pos == 0x4015){
-		return c->a.ce;
+	return 0;
+}
+
+
+void MarkCodePage(struct cpu* c, uint16_t pos){
+	if (pos <= mirrorhead){//ram can be written through any of its mirrors
+		for (uint16_t i = pos % ramsize; i <= mirrorhead; i += ramsize){
+			c->codepages[i>>8] = 1;
+		}
 	}
-	else if (pos >= 0x6000 && pos <= 0xFFF9){
-		return c->cart[pos];
+	else{
+		c->codepages[pos>>8] = 1;
 	}
 }
 
-
 void WriteMemory(struct cpu *c, uint16_t pos, uint8_t val){//writes to certain memory addresses
-	if (pos == 0x07C7){
-		printf("val: %02x", val);
-		printf("\n");
+	if (c->trace){
+		TraceWrite(c,pos,val);
 	}
-	if (pos <= mirrorhead){//write to wam
-		pos = pos % ramsize;
-		c->RAM[pos] = val;
-		return;
+	if (c->codepages[pos>>8]){//self modifying code
+		FlushCode(c);
 	}
-	if ((pos >= 0x4000 && pos <= 0x4013 ) || pos == 0x4015){//apu write
-		APUWrite(&(c->a),val,pos & 0xFF);
+	uint8_t* page = c->writemap[pos >> 8];
+	if (page){
+		page[pos & 0xFF] = val;
+		c->dirtypages[pos >> 8] = 1;
+		return;
 	}
-	else if (pos >= 0x6000 && pos <= 0x7FFF){
-		 c->cart[pos] = val;
+	if (writeio[pos >> 8]){
+		writeio[pos >> 8](c,pos,val);
 	}
-	
 }
 void FetchInstruction(struct cpu* c){
-	//	printf("fetch at address: %d",c->progcount);
-	//	printf("\n");
-	/*	if (c->progcount == 63188){
-			printf("hey\n");
-		}*/
+	const uint8_t* page = c->readmap[c->progcount >> 8];
+	if (page && (c->progcount & 0xFF) <= 0xFD){//all 3 bytes are in the same page
+		page += c->progcount & 0xFF;
+		c->instbuffer[0] = page[0];
+		c->instbuffer[1] = page[1];
+		c->instbuffer[2] = page[2];
+		return;
+	}
 	for (unsigned int i = 0; i < 3; i++){
-		c->instbuffer[i] = c->cart[c->progcount+i];
-	//	printf("data: %02X",c->cart[c->progcount+i]);
-	//	printf("\n");
+		c->instbuffer[i] = ReadMemory(c,c->progcount+i);
 	}
 }
+enum AddressMode{
+	AM_IMP,//implied, no operand
+	AM_ACC,//operates on the accumulator
+	AM_IMM,//immediate, operand is the byte after the opcode
+	AM_ZPG,//zero page
+	AM_ZPX,//zero page, x
+	AM_ZPY,//zero page, y
+	AM_ABS,//absolute
+	AM_ABX,//absolute, x
+	AM_ABY,//absolute, y
+	AM_IND,//indirect, only used by JMP
+	AM_IZX,//(indirect, x)
+	AM_IZY,//(indirect), y
+	AM_REL//relative, only used by the branches
+	};
+struct opcode{
+	void (*exec)(struct cpu* c, uint16_t addr);//handler, gets the effective address already resolved
+	uint8_t length;//bytes taken by the instruction including the opcode
+	uint8_t cycles;//base cycle cost
+	uint8_t amode;//one of AddressMode
+	uint8_t pagecross;//1 if the instruction takes an extra cycle when indexing crosses a page
+};
+void SetNZ(struct cpu* c, uint8_t val){
+	c->nzres = val;
+}
 void ADCFunction(struct cpu* c, uint8_t inc){
-	uint16_t sum;
-	sum = c->acc + inc + ((c->status >> CFLAG) & 0x01);
-	if (sum >= 0xFF){
-		SetPBit(c,CFLAG,1);
-	}
-	else{
-		SetPBit(c,CFLAG,0);
+	uint16_t sum = c->acc + inc + FlagC(c);
+	c->cres = sum;
+	c->vres = ~(c->acc ^ inc) & (c->acc ^ sum);//both inputs had the same sign and the sum doesnt
+	c->acc = sum & 0xFF;
+	c->nzres = c->acc;
+}
+void CompareFunction(struct cpu* c, uint8_t reg, uint8_t val){
+	c->cres = 0x100 + reg - val;//bit 8 survives when there was no borrow
+	c->nzres = c->cres & 0xFF;
+}
+void Branch(struct cpu* c, uint16_t addr, uint8_t taken){
+	if (taken){
+		c->extracycles += ((c->progcount ^ addr) & 0xFF00) ? 2 : 1;//one more if the target is on another page
+		c->progcount = addr;
 	}
-	if ((inc & 0x80 && c->acc & 0x80) && !(sum && 0x80)){//if the inc and acc vals are both negative and the sum isnt then overflow
-		SetPBit(c,VFLAG,1);
+}
+//instruction handlers, by the time these run progcount already points at the next instruction
+void OpNOP(struct cpu* c, uint16_t addr){
+}
+void OpORA(struct cpu* c, uint16_t addr){
+	c->acc |= ReadMemory(c,addr);
+	SetNZ(c,c->acc);
+}
+void OpAND(struct cpu* c, uint16_t addr){
+	c->acc &= ReadMemory(c,addr);
+	SetNZ(c,c->acc);
+}
+void OpEOR(struct cpu* c, uint16_t addr){
+	c->acc ^= ReadMemory(c,addr);
+	SetNZ(c,c->acc);
+}
+void OpADC(struct cpu* c, uint16_t addr){
+	ADCFunction(c,ReadMemory(c,addr));
+}
+void OpSBC(struct cpu* c, uint16_t addr){
+	ADCFunction(c,~ReadMemory(c,addr));
+}
+void OpCMP(struct cpu* c, uint16_t addr){
+	CompareFunction(c,c->acc,ReadMemory(c,addr));
+}
+void OpCPX(struct cpu* c, uint16_t addr){
+	CompareFunction(c,c->x,ReadMemory(c,addr));
+}
+void OpCPY(struct cpu* c, uint16_t addr){
+	CompareFunction(c,c->y,ReadMemory(c,addr));
+}
+void OpBIT(struct cpu* c, uint16_t addr){
+	uint8_t val = ReadMemory(c,addr);
+	c->nzres = (val & c->acc) | ((val & 0x80) << 8);//n comes from memory not from the and
+	c->vres = val << 1;
+}
+void OpLDA(struct cpu* c, uint16_t addr){
+	c->acc = ReadMemory(c,addr);
+	SetNZ(c,c->acc);
+}
+void OpLDX(struct cpu* c, uint16_t addr){
+	c->x = ReadMemory(c,addr);
+	SetNZ(c,c->x);
+}
+void OpLDY(struct cpu* c, uint16_t addr){
+	c->y = ReadMemory(c,addr);
+	SetNZ(c,c->y);
+}
+void OpSTA(struct cpu* c, uint16_t addr){
+	WriteMemory(c,addr,c->acc);
+}
+void OpSTX(struct cpu* c, uint16_t addr){
+	WriteMemory(c,addr,c->x);
+}
+void OpSTY(struct cpu* c, uint16_t addr){
+	WriteMemory(c,addr,c->y);
+}
+void OpASL(struct cpu* c, uint16_t addr){
+	uint8_t val = ReadMemory(c,addr);
+	c->cres = val << 1;
+	val = c->cres & 0xFF;
+	WriteMemory(c,addr,val);
+	SetNZ(c,val);
+}
+void OpASLA(struct cpu* c, uint16_t addr){
+	c->cres = c->acc << 1;
+	c->acc = c->cres & 0xFF;
+	SetNZ(c,c->acc);
+}
+void OpLSR(struct cpu* c, uint16_t addr){
+	uint8_t val = ReadMemory(c,addr);
+	c->cres = (val & 0x01) << 8;
+	val = val >> 1;
+	WriteMemory(c,addr,val);
+	SetNZ(c,val);
+}
+void OpLSRA(struct cpu* c, uint16_t addr){
+	c->cres = (c->acc & 0x01) << 8;
+	c->acc = c->acc >> 1;
+	SetNZ(c,c->acc);
+}
+void OpROL(struct cpu* c, uint16_t addr){
+	uint8_t val = ReadMemory(c,addr);
+	c->cres = (val << 1) | FlagC(c);
+	val = c->cres & 0xFF;
+	WriteMemory(c,addr,val);
+	SetNZ(c,val);
+}
+void OpROLA(struct cpu* c, uint16_t addr){
+	c->cres = (c->acc << 1) | FlagC(c);
+	c->acc = c->cres & 0xFF;
+	SetNZ(c,c->acc);
+}
+void OpROR(struct cpu* c, uint16_t addr){
+	uint8_t val = ReadMemory(c,addr);
+	uint8_t carry = FlagC(c);
+	c->cres = (val & 0x01) << 8;
+	val = (val >> 1) | (carry << 7);
+	WriteMemory(c,addr,val);
+	SetNZ(c,val);
+}
+void OpRORA(struct cpu* c, uint16_t addr){
+	uint8_t carry = FlagC(c);
+	c->cres = (c->acc & 0x01) << 8;
+	c->acc = (c->acc >> 1) | (carry << 7);
+	SetNZ(c,c->acc);
+}
+void OpINC(struct cpu* c, uint16_t addr){
+	uint8_t val = ReadMemory(c,addr) + 1;
+	WriteMemory(c,addr,val);
+	SetNZ(c,val);
+}
+void OpDEC(struct cpu* c, uint16_t addr){
+	uint8_t val = ReadMemory(c,addr) - 1;
+	WriteMemory(c,addr,val);
+	SetNZ(c,val);
+}
+void OpINX(struct cpu* c, uint16_t addr){
+	c->x++;
+	SetNZ(c,c->x);
+}
+void OpINY(struct cpu* c, uint16_t addr){
+	c->y++;
+	SetNZ(c,c->y);
+}
+void OpDEX(struct cpu* c, uint16_t addr){
+	c->x--;
+	SetNZ(c,c->x);
+}
+void OpDEY(struct cpu* c, uint16_t addr){
+	c->y--;
+	SetNZ(c,c->y);
+}
+void OpTAX(struct cpu* c, uint16_t addr){
+	c->x = c->acc;
+	SetNZ(c,c->x);
+}
+void OpTAY(struct cpu* c, uint16_t addr){
+	c->y = c->acc;
+	SetNZ(c,c->y);
+}
+void OpTXA(struct cpu* c, uint16_t addr){
+	c->acc = c->x;
+	SetNZ(c,c->acc);
+}
+void OpTYA(struct cpu* c, uint16_t addr){
+	c->acc = c->y;
+	SetNZ(c,c->acc);
+}
+void OpTSX(struct cpu* c, uint16_t addr){
+	c->x = c->s;
+	SetNZ(c,c->x);
+}
+void OpTXS(struct cpu* c, uint16_t addr){
+	c->s = c->x;
+}
+void OpPHA(struct cpu* c, uint16_t addr){
+	PushStack(c,c->acc);
+}
+void OpPHP(struct cpu* c, uint16_t addr){
+	PushStack(c,GetStatus(c) | 0x30);//B and the unused bit are always set on the pushed copy
+}
+void OpPLA(struct cpu* c, uint16_t addr){
+	c->acc = PopStack(c);
+	SetNZ(c,c->acc);
+}
+void OpPLP(struct cpu* c, uint16_t addr){
+	SetStatus(c,PopStack(c));
+}
+void OpCLC(struct cpu* c, uint16_t addr){
+	SetPBit(c,CFLAG,0);
+}
+void OpSEC(struct cpu* c, uint16_t addr){
+	SetPBit(c,CFLAG,1);
+}
+void OpCLI(struct cpu* c, uint16_t addr){
+	SetPBit(c,IFLAG,0);
+}
+void OpSEI(struct cpu* c, uint16_t addr){
+	SetPBit(c,IFLAG,1);
+}
+void OpCLV(struct cpu* c, uint16_t addr){
+	SetPBit(c,VFLAG,0);
+}
+void OpCLD(struct cpu* c, uint16_t addr){
+	SetPBit(c,DFLAG,0);
+}
+void OpSED(struct cpu* c, uint16_t addr){
+	SetPBit(c,DFLAG,1);
+}
+void OpBPL(struct cpu* c, uint16_t addr){
+	Branch(c,addr,!FlagN(c));
+}
+void OpBMI(struct cpu* c, uint16_t addr){
+	Branch(c,addr,FlagN(c));
+}
+void OpBVC(struct cpu* c, uint16_t addr){
+	Branch(c,addr,!FlagV(c));
+}
+void OpBVS(struct cpu* c, uint16_t addr){
+	Branch(c,addr,FlagV(c));
+}
+void OpBCC(struct cpu* c, uint16_t addr){
+	Branch(c,addr,!FlagC(c));
+}
+void OpBCS(struct cpu* c, uint16_t addr){
+	Branch(c,addr,FlagC(c));
+}
+void OpBNE(struct cpu* c, uint16_t addr){
+	Branch(c,addr,!FlagZ(c));
+}
+void OpBEQ(struct cpu* c, uint16_t addr){
+	Branch(c,addr,FlagZ(c));
+}
+void OpJMP(struct cpu* c, uint16_t addr){
+	c->progcount = addr;
+}
+void OpJSR(struct cpu* c, uint16_t addr){
+	uint16_t ret = c->progcount - 1;//the 6502 pushes the address of the last byte of the jsr
+	PushStack(c,(ret>>8)&0xFF);
+	PushStack(c,ret&0xFF);
+	c->progcount = addr;
+	c->depth++;
+}
+void OpRTS(struct cpu* c, uint16_t addr){
+	if (c->depth){//we've run another subroutine from play/init
+		uint16_t spos = PopStack(c);
+		spos += PopStack(c) << 8;
+		c->progcount = spos + 1;
+		c->depth--;
 	}
-	else if (!(inc & 0x80 || c->acc & 0x80) && sum && 0x80){//if the inc and acc vals are both positive and the sum isnt
-		SetPBit(c,VFLAG,1);
-	}
-	else{SetPBit(c,VFLAG,0);}
-	c->acc = sum & 0xFF;
-	SetPBit(c,NFLAG,c->acc & 0x80);
-	SetPBit(c,ZFLAG, c->acc == 0x00);
-}
-void RunSubset1Instructions(struct cpu* c, uint8_t op, uint8_t amode){
-	//these instructions typically concern the accumulator
-	uint8_t cpos = 0;//used for zero page addressing
-	uint16_t spos = 0;//used for addressing
-	int8_t temp = 0; //used for temporary math
-	switch (op){
-		case 0x00://ORA
-		switch (amode){//addressing mode
-			case 0x00://indirect x zeropage
-			cpos = c->instbuffer[1] + c->x;
-			spos = (c->RAM[cpos+1] << 8) + c->RAM[cpos];
-			c->acc = c->acc | ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x01://zeropage
-			c->acc = c->acc | c->RAM[c->instbuffer[1]];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x02://immediate
-			c->acc = c->acc | c->instbuffer[1];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x03://absolute
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-			c->acc = c->acc | ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			case 0x04://indirect y
-			spos = (ReadMemory(c,c->instbuffer[1]+1) << 8) + ReadMemory(c,c->instbuffer[1])+c->y;
-			c->acc = c->acc | ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x05://zeropage x
-			cpos = c->instbuffer[1] + c->x;
-			c->acc = c->acc | c->RAM[cpos];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x06://absolute y
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->y;
-			c->acc = c->acc | ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			case 0x07:
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-			c->acc = c->acc | ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			default:
-			c->progcount = c->progcount + 1;
-			break;
-		}
-		break;
-		case 0x01://AND
-		switch (amode){//addressing mode
-			case 0x00://indirect x zeropage
-			cpos = c->instbuffer[1] + c->x;
-			spos = (c->RAM[cpos+1] << 8) + c->RAM[cpos];
-			c->acc = c->acc & ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x01://zeropage
-			c->acc = c->acc & c->RAM[c->instbuffer[1]];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x02://immediate
-			c->acc = c->acc & c->instbuffer[1];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x03://absolute
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-			c->acc = c->acc & ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			case 0x04://indirect y
-			spos = (ReadMemory(c,c->instbuffer[1]+1) << 8) + ReadMemory(c,c->instbuffer[1])+c->y;
-			c->acc = c->acc & ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x05://zeropage x
-			cpos = c->instbuffer[1] + c->x;
-			c->acc = c->acc & c->RAM[cpos];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x06://absolute y
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->y;
-			c->acc = c->acc & ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			case 0x07:
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-			c->acc = c->acc & ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			default:
-			c->progcount = c->progcount + 1;
-			break;
-		}
-		break;
-		case 0x02://EOR
-		switch (amode){//addressing mode
-			case 0x00://indirect x zeropage
-			cpos = c->instbuffer[1] + c->x;
-			spos = (c->RAM[cpos+1] << 8) + c->RAM[cpos];
-			c->acc = c->acc ^ ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x01://zeropage
-			c->acc = c->acc ^ c->RAM[c->instbuffer[1]];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x02://immediate
-			c->acc = c->acc ^ c->instbuffer[1];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x03://absolute
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-			c->acc = c->acc ^ ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			case 0x04://indirect y
-			spos = (ReadMemory(c,c->instbuffer[1]+1) << 8) + ReadMemory(c,c->instbuffer[1])+c->y;
-			c->acc = c->acc ^ ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x05://zeropage x
-			cpos = c->instbuffer[1] + c->x;
-			c->acc = c->acc ^ c->RAM[cpos];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x06://absolute y
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->y;
-			c->acc = c->acc ^ ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			case 0x07:
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-			c->acc = c->acc ^ ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			default:
-			c->progcount = c->progcount + 1;
-			break;
-		}
-		break;
-		
-		case 0x03://ADC
-		switch (amode){//addressing mode
-			case 0x00://indirect x zeropage
-			cpos = c->instbuffer[1] + c->x;
-			spos = (c->RAM[cpos+1] << 8) + c->RAM[cpos];
-			cpos = ReadMemory(c,spos);
-			ADCFunction(c,cpos);
-			c->progcount += 2;
-			break;
-			case 0x01://zeropage
-			ADCFunction(c,c->RAM[c->instbuffer[1]]);
-			c->progcount += 2;
-			break;
-			case 0x02://immediate
-			ADCFunction(c,c->instbuffer[1]);
-			c->progcount += 2;
-			break;
-			case 0x03://absolute
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-			ADCFunction(c, ReadMemory(c,spos));
-			c->progcount += 3;
-			break;
-			case 0x04://indirect y
-			spos = (ReadMemory(c,c->instbuffer[1]+1) << 8) + ReadMemory(c,c->instbuffer[1])+c->y;
-			ADCFunction(c, ReadMemory(c,spos));
-			c->progcount += 2;
-			break;
-			case 0x05://zeropage x
-			cpos = c->instbuffer[1] + c->x;
-			ADCFunction(c, c->RAM[cpos]);
-			c->progcount += 2;
-			break;
-			case 0x06://absolute y
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->y;
-			ADCFunction(c, ReadMemory(c,spos));
-			c->progcount += 3;
-			break;
-			case 0x07:
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-			ADCFunction(c, ReadMemory(c,spos));
-			c->progcount += 3;
-			break;
-			default:
-			c->progcount = c->progcount + 1;
-			break;
-		}
-		break;
-		
-		case 0x04://STA
-		switch (amode){//addressing mode
-			case 0x00://indirect x zeropage
-			cpos = c->instbuffer[1] + c->x;
-			spos = (c->RAM[cpos+1] << 8) + c->RAM[cpos];
-			WriteMemory(c,spos,c->acc);
-			c->progcount += 2;
-			break;
-			case 0x01://zeropage
-			WriteMemory(c,c->instbuffer[1],c->acc);
-			c->progcount += 2;
-			break;
-			case 0x02://immediate
-				//illegal
-				c->progcount += 2;
-				break;
-			case 0x03://absolute
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-			WriteMemory(c,spos,c->acc);
-			c->progcount += 3;
-			break;
-			case 0x04://indirect y
-			spos = (ReadMemory(c,c->instbuffer[1]+1) << 8) + ReadMemory(c,c->instbuffer[1])+c->y;
-			WriteMemory(c,spos,c->acc);
-			c->progcount += 2;
-			break;
-			case 0x05://zeropage x
-			cpos = c->instbuffer[1] + c->x;
-			WriteMemory(c,cpos,c->acc);
-			c->progcount += 2;
-			break;
-			case 0x06://absolute y
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->y;
-			WriteMemory(c,spos,c->acc);
-			c->progcount += 3;
-			break;
-			case 0x07://absolute x
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-			WriteMemory(c,spos,c->acc);
-			c->progcount += 3;
-			break;
-			default:
-			c->progcount = c->progcount + 1;
-			break;
-		}
-		break;
-		case 0x05://LDA
-		switch (amode){//addressing mode
-			case 0x00://indirect x zeropage
-			cpos = c->instbuffer[1] + c->x;
-			spos = (c->RAM[cpos+1] << 8) + c->RAM[cpos];
-			c->acc = ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x01://zeropage
-			c->acc = ReadMemory(c,c->instbuffer[1]);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x02://immediate
-			c->acc = c->instbuffer[1];
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x03://absolute
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-			c->acc = ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			case 0x04://indirect y
-			spos = (ReadMemory(c,c->instbuffer[1]+1) << 8) + ReadMemory(c,c->instbuffer[1])+c->y;
-			c->acc = ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x05://zeropage x
-			cpos = c->instbuffer[1] + c->x;
-			c->acc = ReadMemory(c,cpos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 2;
-			break;
-			case 0x06://absolute y
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->y;
-			c->acc = ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			case 0x07://absolute x
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-			c->acc = ReadMemory(c,spos);
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			c->progcount += 3;
-			break;
-			default:
-			c->progcount = c->progcount + 1;
-			break;
-		}
-		break;
-		case 0x06://CMP
-		switch (amode){//addressing mode
-			case 0x00://indirect x zeropage
-			cpos = c->instbuffer[1] + c->x;
-			spos = (c->RAM[cpos+1] << 8) + c->RAM[cpos];
-			temp = c->acc - ReadMemory(c,spos);
-			SetPBit(c,NFLAG,temp & 0x80);
-			SetPBit(c,ZFLAG, temp == 0x00);
-			SetPBit(c,CFLAG, temp >= 0);
-			c->progcount += 2;
-			break;
-			case 0x01://zeropage
-			temp = c->acc - ReadMemory(c,c->instbuffer[1]);
-			SetPBit(c,NFLAG,temp & 0x80);
-			SetPBit(c,ZFLAG, temp == 0x00);
-			SetPBit(c,CFLAG, temp >= 0);
-			c->progcount += 2;
-			break;
-			case 0x02://immediate
-			temp = c->acc - c->instbuffer[1];
-			SetPBit(c,NFLAG,temp & 0x80);
-			SetPBit(c,ZFLAG, temp == 0x00);
-			SetPBit(c,CFLAG, temp >= 0);
-			c->progcount += 2;
-			break;
-			case 0x03://absolute
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-			temp = c->acc - ReadMemory(c,spos);
-			SetPBit(c,NFLAG,temp & 0x80);
-			SetPBit(c,ZFLAG, temp == 0x00);
-			SetPBit(c,CFLAG, temp >= 0);
-			c->progcount += 3;
-			break;
-			case 0x04://indirect y
-			spos = (ReadMemory(c,c->instbuffer[1]+1) << 8) + ReadMemory(c,c->instbuffer[1])+c->y;
-			temp = c->acc - ReadMemory(c,spos);
-			SetPBit(c,NFLAG,temp & 0x80);
-			SetPBit(c,ZFLAG, temp == 0x00);
-			SetPBit(c,CFLAG, temp >= 0);
-			c->progcount += 2;
-			break;
-			case 0x05://zeropage x
-			cpos = c->instbuffer[1] + c->x;
-			temp = c->acc - ReadMemory(c,cpos);
-			SetPBit(c,NFLAG,temp & 0x80);
-			SetPBit(c,ZFLAG, temp == 0x00);
-			SetPBit(c,CFLAG, temp >= 0);
-			c->progcount += 2;
-			break;
-			case 0x06://absolute y
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->y;
-			temp = c->acc - ReadMemory(c,spos);
-			SetPBit(c,NFLAG,temp & 0x80);
-			SetPBit(c,ZFLAG, temp == 0x00);
-			SetPBit(c,CFLAG, temp >= 0);
-			c->progcount += 3;
-			break;
-			case 0x07://absolute x
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-			temp = c->acc - ReadMemory(c,spos);
-			SetPBit(c,NFLAG,temp & 0x80);
-			SetPBit(c,ZFLAG, temp == 0x00);
-			SetPBit(c,CFLAG, temp >= 0);
-			c->progcount += 3;
-			break;
-			default:
-			c->progcount = c->progcount + 1;
-			break;
-		}
-		break;
-		case 0x07://SBC
-		switch (amode){//addressing mode
-			case 0x00://indirect x zeropage
-			cpos = c->instbuffer[1] + c->x;
-			spos = (c->RAM[cpos+1] << 8) + c->RAM[cpos];
-			cpos = ReadMemory(c,spos);
-			ADCFunction(c,~cpos);
-			c->progcount += 2;
-			break;
-			case 0x01://zeropage
-			ADCFunction(c,~c->RAM[c->instbuffer[1]]);
-			c->progcount += 2;
-			break;
-			case 0x02://immediate
-			ADCFunction(c,~c->instbuffer[1]);
-			c->progcount += 2;
-			break;
-			case 0x03://absolute
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-			ADCFunction(c, ~ReadMemory(c,spos));
-			c->progcount += 3;
-			break;
-			case 0x04://indirect y
-			spos = (ReadMemory(c,c->instbuffer[1]+1) << 8) + ReadMemory(c,c->instbuffer[1])+c->y;
-			ADCFunction(c, ~ReadMemory(c,spos));
-			c->progcount += 2;
-			break;
-			case 0x05://zeropage x
-			cpos = c->instbuffer[1] + c->x;
-			ADCFunction(c, ~c->RAM[cpos]);
-			c->progcount += 2;
-			break;
-			case 0x06://absolute y
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->y;
-			ADCFunction(c, ~ReadMemory(c,spos));
-			c->progcount += 3;
-			break;
-			case 0x07:
-			spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-			ADCFunction(c, ~ReadMemory(c,spos));
-			c->progcount += 3;
-			break;
-			default:
-			c->progcount = c->progcount + 1;
-			break;
-		}
-		break;
-		default:
-		break;
+	else{//if we are returning from play/init
+		c->playing = 0;
 	}
 }
+void OpBRK(struct cpu* c, uint16_t addr){
+	//this instructons probably shouldnt ever happen
+	uint16_t ret = c->progcount + 1;//brk skips a padding byte
+	PushStack(c,(ret>>8)&0xFF);
+	PushStack(c,ret&0xFF);
+	PushStack(c,GetStatus(c) | 0x30);
+	SetPBit(c,IFLAG,1);
+	c->progcount = (ReadMemory(c,0xFFFF) << 8) + ReadMemory(c,0xFFFE);
+}
+void OpRTI(struct cpu* c, uint16_t addr){
+	//this also probably shouldnt happen
+	SetStatus(c,PopStack(c));
+	uint16_t spos = PopStack(c);
+	spos += PopStack(c) << 8;
+	c->progcount = spos;
+}
 
-void RunSubset2Instructions(struct cpu* c, uint8_t op, uint8_t amode){
-	//these instructions typically concern the x register
-	uint8_t cpos = 0;//used for zero page addressing
-	uint16_t spos = 0;//used for addressing
-	int8_t temp = 0; //used for temporary math
-	uint8_t utemp = 0;//used for unsigned temporary math
-	switch (op){
-		case 0x00://ASL
-			switch(amode){
-				case 0://immediate
-					//this shouldnt happen apparently
-					c->progcount+= 2;
-					break;
-				case 1://zeropage
-					utemp = c->RAM[c->instbuffer[1]];
-					SetPBit(c,CFLAG,utemp&0x80);
-					utemp = utemp<<1;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					c->RAM[c->instbuffer[1]] = utemp;
-					c->progcount+= 2;
-					break;
-				case 2://accumulator
-					SetPBit(c,CFLAG,c->acc&0x80);
-					utemp = c->acc;
-					utemp = utemp << 1;
-					c->acc = utemp;
-					SetPBit(c,ZFLAG,!c->acc);
-					SetPBit(c,NFLAG,c->acc&0x80);
-					c->progcount+= 1;
-					break;
-				case 3://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					utemp = ReadMemory(c,spos);
-					SetPBit(c,CFLAG,utemp&0x80);
-					utemp = utemp<<1;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					WriteMemory(c,spos,utemp);
-					c->progcount+= 3;
-					break;
-				case 4://this case is illegal
-					c->progcount+= 2;
-					break;
-				case 5://zero page, x
-					cpos = c->instbuffer[1] + c->x;
-					utemp = c->RAM[cpos];
-					SetPBit(c,CFLAG,utemp&0x80);
-					utemp = utemp<<1;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					c->RAM[cpos] = utemp;
-					c->progcount+= 2;
-					break;
-				case 6://this case is illegal
-					c->progcount+= 2;
-					break;
-				case 7://absolute, x
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-					utemp = ReadMemory(c,spos);
-					SetPBit(c,CFLAG,temp&0x80);
-					utemp = utemp<<1;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					WriteMemory(c,spos,utemp);
-					c->progcount+= 3;
-					break;
-			}	
-			break;
-		case 0x01://ROL
-			switch(amode){
-				case 0://immediate
-				//this shouldnt happen apparently
-					c->progcount+= 2;
-					break;
-				case 1://zeropage
-					utemp = c->RAM[c->instbuffer[1]];
-					cpos = GetPBit(c,CFLAG);
-					SetPBit(c,CFLAG,utemp&0x80);
-					utemp = utemp<<1;
-					utemp |= cpos;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					c->RAM[c->instbuffer[1]] = utemp;
-					c->progcount+= 2;
-					break;
-				case 2://accumulator
-					utemp = c->acc;
-					utemp = utemp <<1;
-					utemp |= GetPBit(c,CFLAG);
-					SetPBit(c,CFLAG,c->acc&0x80);
-					c->acc = utemp;
-					SetPBit(c,ZFLAG,!c->acc);
-					SetPBit(c,NFLAG,c->acc&0x80);
-					c->progcount+= 1;
-					break;
-				case 3://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					utemp = ReadMemory(c,spos);
-					cpos = GetPBit(c,CFLAG);
-					SetPBit(c,CFLAG,utemp&0x80);
-					utemp = utemp<<1;
-					utemp |= cpos;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					WriteMemory(c,spos,utemp);
-					c->progcount+= 3;
-					break;
-				case 4://this case is illegal
-					c->progcount+= 2;
-					break;
-				case 5://zero page, x
-					cpos = c->instbuffer[1] + c->x;
-					utemp = c->RAM[cpos];
-					spos = GetPBit(c,CFLAG);
-					SetPBit(c,CFLAG,utemp&0x80);
-					utemp = utemp<<1;
-					utemp |= (spos && 0xFF);
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					c->RAM[cpos] = utemp;
-					c->progcount+= 2;
-					break;
-				case 6://this case is illegal
-					c->progcount+= 2;
-					break;
-				case 7://absolute, x
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-					cpos = GetPBit(c,CFLAG);
-					utemp = ReadMemory(c,spos);
-					SetPBit(c,CFLAG,temp&0x80);
-					utemp = (char)(utemp)<<1;
-					utemp |= cpos;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					WriteMemory(c,spos,utemp);
-					c->progcount+= 3;
-				break;
-			}
-			break;
-		case 0x02://LSR
-			switch(amode){
-				case 0://immediate
-					//this shouldnt happen apparently
-					c->progcount+= 2;
-					break;
-				case 1://zeropage
-					utemp = c->RAM[c->instbuffer[1]];
-					SetPBit(c,CFLAG,utemp&0x01);
-					utemp = utemp>>1;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,0);
-					c->RAM[c->instbuffer[1]] = utemp;
-					c->progcount+= 2;
-					break;
-				case 2://accumulator
-					SetPBit(c,CFLAG,c->acc&0x01);
-					utemp = c->acc;
-					utemp = utemp >>1;
-					c->acc = utemp;
-					SetPBit(c,ZFLAG,!c->acc);
-					SetPBit(c,NFLAG,0);
-					c->progcount+= 1;
-					break;
-				case 3://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					utemp = ReadMemory(c,spos);
-					SetPBit(c,CFLAG,utemp&0x01);
-					utemp = utemp>>1;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,0);
-					WriteMemory(c,spos,utemp);
-					c->progcount+= 3;
-					break;
-				case 4://this case is illegal
-					c->progcount+= 2;
-					break;
-				case 5://zero page, x
-					cpos = c->instbuffer[1] + c->x;
-					utemp = c->RAM[cpos];
-					SetPBit(c,CFLAG,utemp&0x01);
-					utemp = utemp>>1;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,0);
-					c->RAM[cpos] = utemp;
-					c->progcount+= 2;
-					break;
-				case 6://this case is illegal
-					c->progcount+= 2;
-					break;
-				case 7://absolute, x
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-					utemp = ReadMemory(c,spos);
-					SetPBit(c,CFLAG,temp&0x01);
-					utemp = utemp>>1;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,0);
-					WriteMemory(c,spos,utemp);
-					c->progcount+= 3;
-					break;
-			}
-			break;
-		case 0x03://ROR
-			switch(amode){
-				case 0://immediate
-					//this shouldnt happen apparently
-					c->progcount+= 2;
-				break;
-				case 1://zeropage
-					utemp = c->RAM[c->instbuffer[1]];
-					cpos = GetPBit(c,CFLAG);
-					SetPBit(c,CFLAG,utemp&0x01);
-					utemp = utemp>>1;
-					utemp |= cpos << 7;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					c->RAM[c->instbuffer[1]] = utemp;
-					c->progcount+= 2;
-					break;
-				case 2://accumulator
-					SetPBit(c,CFLAG,c->acc&0x01);
-					cpos = GetPBit(c,CFLAG);
-					utemp = c->acc;
-					utemp = utemp >>1;
-					utemp |= cpos << 7;
-					c->acc = utemp;
-					SetPBit(c,ZFLAG,!c->acc);
-					SetPBit(c,NFLAG,c->acc&0x80);
-					c->progcount+= 1;
-					break;
-				case 3://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					utemp = ReadMemory(c,spos);
-					cpos = GetPBit(c,CFLAG);
-					SetPBit(c,CFLAG,utemp&0x01);
-					utemp = utemp>>1;
-					utemp |= cpos << 7;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					WriteMemory(c,spos,utemp);
-					c->progcount+= 3;
-					break;
-				case 4://this case is illegal
-					c->progcount+= 2;
-					break;
-				case 5://zero page, x
-					cpos = c->instbuffer[1] + c->x;
-					utemp = c->RAM[cpos];
-					spos = GetPBit(c,CFLAG);
-					SetPBit(c,CFLAG,utemp&0x01);
-					utemp = utemp>>1;
-					utemp |= (spos << 7) & 0xFF;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					c->RAM[cpos] = utemp;
-					c->progcount+= 2;
-					break;
-				case 6://this case is illegal
-					c->progcount+= 2;
-					break;
-				case 7://absolute, x
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-					utemp = ReadMemory(c,spos);
-					cpos = GetPBit(c,CFLAG);
-					SetPBit(c,CFLAG,temp&0x01);
-					utemp = utemp>>1;
-					utemp |= cpos << 7;
-					SetPBit(c,ZFLAG,!utemp);
-					SetPBit(c,NFLAG,utemp&0x80);
-					WriteMemory(c,spos,utemp);
-					c->progcount+= 3;
-					break;
-			}
-			break;
-		case 0x04://STX
-			switch (amode){//addressing mode
-					case 0x00://indirect x zeropage
-					//illegal
-					c->progcount+= 2;
-					break;
-				case 0x01://zeropage
-					WriteMemory(c,c->instbuffer[1],c->x);
-					c->progcount += 2;
-					break;
-				case 0x02://immediate
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x03://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					WriteMemory(c,spos,c->x);
-					c->progcount += 3;
-					break;
-				case 0x04://indirect y
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x05://zeropage y
-					cpos = c->instbuffer[1] + c->y;
-					WriteMemory(c,cpos,c->x);
-					c->progcount += 2;
-					break;
-				case 0x06://absolute y
-					//illegal
-					c->progcount += 3;
-					break;
-				case 0x07://absolute x
-					//illegal
-					c->progcount += 3;
-					break;
-				default:
-					c->progcount = c->progcount + 1;
-					break;
-			}
-			break;
-		case 0x05://LDX
-			switch (amode){//addressing mode
-				case 0x00://immediate
-					c->x = c->instbuffer[1];
-					SetPBit(c,NFLAG,c->x & 0x80);
-					SetPBit(c,ZFLAG, c->x == 0x00);
-					c->progcount += 2;
-					break;
-				case 0x01://zeropage
-					c->x = ReadMemory(c,c->instbuffer[1]);
-					SetPBit(c,NFLAG,c->x & 0x80);
-					SetPBit(c,ZFLAG, c->x == 0x00);
-					c->progcount += 2;
-					break;
-				case 0x02://accumulator
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x03://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					c->x = ReadMemory(c,spos);
-					SetPBit(c,NFLAG,c->x & 0x80);
-					SetPBit(c,ZFLAG, c->x == 0x00);
-					c->progcount += 3;
-					break;
-				case 0x04://indirect y
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x05://zeropage y
-					cpos = c->instbuffer[1] + c->y;
-					c->x = ReadMemory(c,cpos);
-					SetPBit(c,NFLAG,c->x & 0x80);
-					SetPBit(c,ZFLAG, c->x == 0x00);
-					c->progcount += 2;
-					break;
-				case 0x06://absolute y
-					//illegal
-					c->progcount += 3;
-					break;
-				case 0x07://absolute y
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->y;
-					c->x = ReadMemory(c,spos);
-					SetPBit(c,NFLAG,c->x & 0x80);
-					SetPBit(c,ZFLAG, c->x == 0x00);
-					c->progcount += 3;
-					break;
-				default:
-					c->progcount = c->progcount + 1;
-					break;
-			}
-			break;
-		case 0x06://DEC
-			switch (amode){//addressing mode
-				case 0x00://immediate
-					//illegal
-					break;
-				case 0x01://zeropage
-					temp = ReadMemory(c,c->instbuffer[1]);
-					temp--;
-					WriteMemory(c,c->instbuffer[1],temp);
-					SetPBit(c,NFLAG,temp& 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					c->progcount += 2;
-				break;
-				case 0x02://acc
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x03://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					temp = ReadMemory(c,spos);
-					temp--;
-					WriteMemory(c,spos,temp);
-					SetPBit(c,NFLAG,temp& 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					c->progcount += 3;
-					break;
-				case 0x04:
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x05://zeropage x
-					cpos = c->instbuffer[1] + c->x;
-					temp = ReadMemory(c,cpos);
-					temp--;
-					WriteMemory(c,cpos,temp);
-					SetPBit(c,NFLAG,temp& 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					c->progcount += 2;
-					break;
-				case 0x06://absolute y
-					//illegal
-					c->progcount += 3;
-					break;
-				case 0x07://absolute x
-					//illegal
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-					temp = ReadMemory(c,spos);
-					temp--;
-					WriteMemory(c,spos,temp);
-					SetPBit(c,NFLAG,temp& 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					c->progcount += 3;
-					break;
-				default:
-					c->progcount = c->progcount + 1;
-					break;
-			}
-			break;
-		case 0x07://INC
-		switch (amode){//addressing mode
-			case 0x00://immediate
-				//illegal
-				break;
-			case 0x01://zeropage
-				temp = ReadMemory(c,c->instbuffer[1]);
-				temp++;
-				WriteMemory(c,c->instbuffer[1],temp);
-				SetPBit(c,NFLAG,temp& 0x80);
-				SetPBit(c,ZFLAG, temp == 0x00);
-				c->progcount += 2;
-				break;
-			case 0x02://acc
-				//illegal
-				c->progcount += 2;
-				break;
-			case 0x03://absolute
-				spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-				temp = ReadMemory(c,spos);
-				temp++;
-				WriteMemory(c,spos,temp);
-				SetPBit(c,NFLAG,temp& 0x80);
-				SetPBit(c,ZFLAG, temp == 0x00);
-				c->progcount += 3;
-				break;
-			case 0x04:
-				//illegal
-				c->progcount += 2;
-				break;
-			case 0x05://zeropage x
-				cpos = c->instbuffer[1] + c->x;
-				temp = ReadMemory(c,cpos);
-				temp++;
-				WriteMemory(c,cpos,temp);
-				SetPBit(c,NFLAG,temp& 0x80);
-				SetPBit(c,ZFLAG, temp == 0x00);
-				c->progcount += 2;
-				break;
-			case 0x06://absolute y
-				//illegal
-				c->progcount += 3;
-				break;
-			case 0x07://absolute x
-				//illegal
-				spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-				temp = ReadMemory(c,spos);
-				temp++;
-				WriteMemory(c,spos,temp);
-				SetPBit(c,NFLAG,temp& 0x80);
-				SetPBit(c,ZFLAG, temp == 0x00);
-				c->progcount += 3;
-				break;
-			default:
-				c->progcount = c->progcount + 1;
-				break;
-		}
-		break;
+//one entry per opcode, unofficial opcodes run as nops of the right length so the pc stays in sync
+const struct opcode opcodes[256] = {
+	{OpBRK,1,7,AM_IMP,0},//0x00 BRK
+	{OpORA,2,6,AM_IZX,0},//0x01 ORA (zp,x)
+	{OpNOP,1,2,AM_IMP,0},//0x02
+	{OpNOP,2,8,AM_IZX,0},//0x03
+	{OpNOP,2,3,AM_ZPG,0},//0x04
+	{OpORA,2,3,AM_ZPG,0},//0x05 ORA zp
+	{OpASL,2,5,AM_ZPG,0},//0x06 ASL zp
+	{OpNOP,2,5,AM_ZPG,0},//0x07
+	{OpPHP,1,3,AM_IMP,0},//0x08 PHP
+	{OpORA,2,2,AM_IMM,0},//0x09 ORA #
+	{OpASLA,1,2,AM_ACC,0},//0x0A ASL A
+	{OpNOP,2,2,AM_IMM,0},//0x0B
+	{OpNOP,3,4,AM_ABS,0},//0x0C
+	{OpORA,3,4,AM_ABS,0},//0x0D ORA abs
+	{OpASL,3,6,AM_ABS,0},//0x0E ASL abs
+	{OpNOP,3,6,AM_ABS,0},//0x0F
+	{OpBPL,2,2,AM_REL,0},//0x10 BPL
+	{OpORA,2,5,AM_IZY,1},//0x11 ORA (zp),y
+	{OpNOP,1,2,AM_IMP,0},//0x12
+	{OpNOP,2,8,AM_IZY,0},//0x13
+	{OpNOP,2,4,AM_ZPX,0},//0x14
+	{OpORA,2,4,AM_ZPX,0},//0x15 ORA zp,x
+	{OpASL,2,6,AM_ZPX,0},//0x16 ASL zp,x
+	{OpNOP,2,6,AM_ZPX,0},//0x17
+	{OpCLC,1,2,AM_IMP,0},//0x18 CLC
+	{OpORA,3,4,AM_ABY,1},//0x19 ORA abs,y
+	{OpNOP,1,2,AM_IMP,0},//0x1A
+	{OpNOP,3,7,AM_ABY,0},//0x1B
+	{OpNOP,3,4,AM_ABX,1},//0x1C
+	{OpORA,3,4,AM_ABX,1},//0x1D ORA abs,x
+	{OpASL,3,7,AM_ABX,0},//0x1E ASL abs,x
+	{OpNOP,3,7,AM_ABX,0},//0x1F
+	{OpJSR,3,6,AM_ABS,0},//0x20 JSR
+	{OpAND,2,6,AM_IZX,0},//0x21 AND (zp,x)
+	{OpNOP,1,2,AM_IMP,0},//0x22
+	{OpNOP,2,8,AM_IZX,0},//0x23
+	{OpBIT,2,3,AM_ZPG,0},//0x24 BIT zp
+	{OpAND,2,3,AM_ZPG,0},//0x25 AND zp
+	{OpROL,2,5,AM_ZPG,0},//0x26 ROL zp
+	{OpNOP,2,5,AM_ZPG,0},//0x27
+	{OpPLP,1,4,AM_IMP,0},//0x28 PLP
+	{OpAND,2,2,AM_IMM,0},//0x29 AND #
+	{OpROLA,1,2,AM_ACC,0},//0x2A ROL A
+	{OpNOP,2,2,AM_IMM,0},//0x2B
+	{OpBIT,3,4,AM_ABS,0},//0x2C BIT abs
+	{OpAND,3,4,AM_ABS,0},//0x2D AND abs
+	{OpROL,3,6,AM_ABS,0},//0x2E ROL abs
+	{OpNOP,3,6,AM_ABS,0},//0x2F
+	{OpBMI,2,2,AM_REL,0},//0x30 BMI
+	{OpAND,2,5,AM_IZY,1},//0x31 AND (zp),y
+	{OpNOP,1,2,AM_IMP,0},//0x32
+	{OpNOP,2,8,AM_IZY,0},//0x33
+	{OpNOP,2,4,AM_ZPX,0},//0x34
+	{OpAND,2,4,AM_ZPX,0},//0x35 AND zp,x
+	{OpROL,2,6,AM_ZPX,0},//0x36 ROL zp,x
+	{OpNOP,2,6,AM_ZPX,0},//0x37
+	{OpSEC,1,2,AM_IMP,0},//0x38 SEC
+	{OpAND,3,4,AM_ABY,1},//0x39 AND abs,y
+	{OpNOP,1,2,AM_IMP,0},//0x3A
+	{OpNOP,3,7,AM_ABY,0},//0x3B
+	{OpNOP,3,4,AM_ABX,1},//0x3C
+	{OpAND,3,4,AM_ABX,1},//0x3D AND abs,x
+	{OpROL,3,7,AM_ABX,0},//0x3E ROL abs,x
+	{OpNOP,3,7,AM_ABX,0},//0x3F
+	{OpRTI,1,6,AM_IMP,0},//0x40 RTI
+	{OpEOR,2,6,AM_IZX,0},//0x41 EOR (zp,x)
+	{OpNOP,1,2,AM_IMP,0},//0x42
+	{OpNOP,2,8,AM_IZX,0},//0x43
+	{OpNOP,2,3,AM_ZPG,0},//0x44
+	{OpEOR,2,3,AM_ZPG,0},//0x45 EOR zp
+	{OpLSR,2,5,AM_ZPG,0},//0x46 LSR zp
+	{OpNOP,2,5,AM_ZPG,0},//0x47
+	{OpPHA,1,3,AM_IMP,0},//0x48 PHA
+	{OpEOR,2,2,AM_IMM,0},//0x49 EOR #
+	{OpLSRA,1,2,AM_ACC,0},//0x4A LSR A
+	{OpNOP,2,2,AM_IMM,0},//0x4B
+	{OpJMP,3,3,AM_ABS,0},//0x4C JMP abs
+	{OpEOR,3,4,AM_ABS,0},//0x4D EOR abs
+	{OpLSR,3,6,AM_ABS,0},//0x4E LSR abs
+	{OpNOP,3,6,AM_ABS,0},//0x4F
+	{OpBVC,2,2,AM_REL,0},//0x50 BVC
+	{OpEOR,2,5,AM_IZY,1},//0x51 EOR (zp),y
+	{OpNOP,1,2,AM_IMP,0},//0x52
+	{OpNOP,2,8,AM_IZY,0},//0x53
+	{OpNOP,2,4,AM_ZPX,0},//0x54
+	{OpEOR,2,4,AM_ZPX,0},//0x55 EOR zp,x
+	{OpLSR,2,6,AM_ZPX,0},//0x56 LSR zp,x
+	{OpNOP,2,6,AM_ZPX,0},//0x57
+	{OpCLI,1,2,AM_IMP,0},//0x58 CLI
+	{OpEOR,3,4,AM_ABY,1},//0x59 EOR abs,y
+	{OpNOP,1,2,AM_IMP,0},//0x5A
+	{OpNOP,3,7,AM_ABY,0},//0x5B
+	{OpNOP,3,4,AM_ABX,1},//0x5C
+	{OpEOR,3,4,AM_ABX,1},//0x5D EOR abs,x
+	{OpLSR,3,7,AM_ABX,0},//0x5E LSR abs,x
+	{OpNOP,3,7,AM_ABX,0},//0x5F
+	{OpRTS,1,6,AM_IMP,0},//0x60 RTS
+	{OpADC,2,6,AM_IZX,0},//0x61 ADC (zp,x)
+	{OpNOP,1,2,AM_IMP,0},//0x62
+	{OpNOP,2,8,AM_IZX,0},//0x63
+	{OpNOP,2,3,AM_ZPG,0},//0x64
+	{OpADC,2,3,AM_ZPG,0},//0x65 ADC zp
+	{OpROR,2,5,AM_ZPG,0},//0x66 ROR zp
+	{OpNOP,2,5,AM_ZPG,0},//0x67
+	{OpPLA,1,4,AM_IMP,0},//0x68 PLA
+	{OpADC,2,2,AM_IMM,0},//0x69 ADC #
+	{OpRORA,1,2,AM_ACC,0},//0x6A ROR A
+	{OpNOP,2,2,AM_IMM,0},//0x6B
+	{OpJMP,3,5,AM_IND,0},//0x6C JMP (abs)
+	{OpADC,3,4,AM_ABS,0},//0x6D ADC abs
+	{OpROR,3,6,AM_ABS,0},//0x6E ROR abs
+	{OpNOP,3,6,AM_ABS,0},//0x6F
+	{OpBVS,2,2,AM_REL,0},//0x70 BVS
+	{OpADC,2,5,AM_IZY,1},//0x71 ADC (zp),y
+	{OpNOP,1,2,AM_IMP,0},//0x72
+	{OpNOP,2,8,AM_IZY,0},//0x73
+	{OpNOP,2,4,AM_ZPX,0},//0x74
+	{OpADC,2,4,AM_ZPX,0},//0x75 ADC zp,x
+	{OpROR,2,6,AM_ZPX,0},//0x76 ROR zp,x
+	{OpNOP,2,6,AM_ZPX,0},//0x77
+	{OpSEI,1,2,AM_IMP,0},//0x78 SEI
+	{OpADC,3,4,AM_ABY,1},//0x79 ADC abs,y
+	{OpNOP,1,2,AM_IMP,0},//0x7A
+	{OpNOP,3,7,AM_ABY,0},//0x7B
+	{OpNOP,3,4,AM_ABX,1},//0x7C
+	{OpADC,3,4,AM_ABX,1},//0x7D ADC abs,x
+	{OpROR,3,7,AM_ABX,0},//0x7E ROR abs,x
+	{OpNOP,3,7,AM_ABX,0},//0x7F
+	{OpNOP,2,2,AM_IMM,0},//0x80
+	{OpSTA,2,6,AM_IZX,0},//0x81 STA (zp,x)
+	{OpNOP,2,2,AM_IMM,0},//0x82
+	{OpNOP,2,6,AM_IZX,0},//0x83
+	{OpSTY,2,3,AM_ZPG,0},//0x84 STY zp
+	{OpSTA,2,3,AM_ZPG,0},//0x85 STA zp
+	{OpSTX,2,3,AM_ZPG,0},//0x86 STX zp
+	{OpNOP,2,3,AM_ZPG,0},//0x87
+	{OpDEY,1,2,AM_IMP,0},//0x88 DEY
+	{OpNOP,2,2,AM_IMM,0},//0x89
+	{OpTXA,1,2,AM_IMP,0},//0x8A TXA
+	{OpNOP,2,2,AM_IMM,0},//0x8B
+	{OpSTY,3,4,AM_ABS,0},//0x8C STY abs
+	{OpSTA,3,4,AM_ABS,0},//0x8D STA abs
+	{OpSTX,3,4,AM_ABS,0},//0x8E STX abs
+	{OpNOP,3,4,AM_ABS,0},//0x8F
+	{OpBCC,2,2,AM_REL,0},//0x90 BCC
+	{OpSTA,2,6,AM_IZY,0},//0x91 STA (zp),y
+	{OpNOP,1,2,AM_IMP,0},//0x92
+	{OpNOP,2,6,AM_IZY,0},//0x93
+	{OpSTY,2,4,AM_ZPX,0},//0x94 STY zp,x
+	{OpSTA,2,4,AM_ZPX,0},//0x95 STA zp,x
+	{OpSTX,2,4,AM_ZPY,0},//0x96 STX zp,y
+	{OpNOP,2,4,AM_ZPY,0},//0x97
+	{OpTYA,1,2,AM_IMP,0},//0x98 TYA
+	{OpSTA,3,5,AM_ABY,0},//0x99 STA abs,y
+	{OpTXS,1,2,AM_IMP,0},//0x9A TXS
+	{OpNOP,3,5,AM_ABY,0},//0x9B
+	{OpNOP,3,5,AM_ABX,0},//0x9C
+	{OpSTA,3,5,AM_ABX,0},//0x9D STA abs,x
+	{OpNOP,3,5,AM_ABY,0},//0x9E
+	{OpNOP,3,5,AM_ABY,0},//0x9F
+	{OpLDY,2,2,AM_IMM,0},//0xA0 LDY #
+	{OpLDA,2,6,AM_IZX,0},//0xA1 LDA (zp,x)
+	{OpLDX,2,2,AM_IMM,0},//0xA2 LDX #
+	{OpNOP,2,6,AM_IZX,0},//0xA3
+	{OpLDY,2,3,AM_ZPG,0},//0xA4 LDY zp
+	{OpLDA,2,3,AM_ZPG,0},//0xA5 LDA zp
+	{OpLDX,2,3,AM_ZPG,0},//0xA6 LDX zp
+	{OpNOP,2,3,AM_ZPG,0},//0xA7
+	{OpTAY,1,2,AM_IMP,0},//0xA8 TAY
+	{OpLDA,2,2,AM_IMM,0},//0xA9 LDA #
+	{OpTAX,1,2,AM_IMP,0},//0xAA TAX
+	{OpNOP,2,2,AM_IMM,0},//0xAB
+	{OpLDY,3,4,AM_ABS,0},//0xAC LDY abs
+	{OpLDA,3,4,AM_ABS,0},//0xAD LDA abs
+	{OpLDX,3,4,AM_ABS,0},//0xAE LDX abs
+	{OpNOP,3,4,AM_ABS,0},//0xAF
+	{OpBCS,2,2,AM_REL,0},//0xB0 BCS
+	{OpLDA,2,5,AM_IZY,1},//0xB1 LDA (zp),y
+	{OpNOP,1,2,AM_IMP,0},//0xB2
+	{OpNOP,2,5,AM_IZY,1},//0xB3
+	{OpLDY,2,4,AM_ZPX,0},//0xB4 LDY zp,x
+	{OpLDA,2,4,AM_ZPX,0},//0xB5 LDA zp,x
+	{OpLDX,2,4,AM_ZPY,0},//0xB6 LDX zp,y
+	{OpNOP,2,4,AM_ZPY,0},//0xB7
+	{OpCLV,1,2,AM_IMP,0},//0xB8 CLV
+	{OpLDA,3,4,AM_ABY,1},//0xB9 LDA abs,y
+	{OpTSX,1,2,AM_IMP,0},//0xBA TSX
+	{OpNOP,3,4,AM_ABY,1},//0xBB
+	{OpLDY,3,4,AM_ABX,1},//0xBC LDY abs,x
+	{OpLDA,3,4,AM_ABX,1},//0xBD LDA abs,x
+	{OpLDX,3,4,AM_ABY,1},//0xBE LDX abs,y
+	{OpNOP,3,4,AM_ABY,1},//0xBF
+	{OpCPY,2,2,AM_IMM,0},//0xC0 CPY #
+	{OpCMP,2,6,AM_IZX,0},//0xC1 CMP (zp,x)
+	{OpNOP,2,2,AM_IMM,0},//0xC2
+	{OpNOP,2,8,AM_IZX,0},//0xC3
+	{OpCPY,2,3,AM_ZPG,0},//0xC4 CPY zp
+	{OpCMP,2,3,AM_ZPG,0},//0xC5 CMP zp
+	{OpDEC,2,5,AM_ZPG,0},//0xC6 DEC zp
+	{OpNOP,2,5,AM_ZPG,0},//0xC7
+	{OpINY,1,2,AM_IMP,0},//0xC8 INY
+	{OpCMP,2,2,AM_IMM,0},//0xC9 CMP #
+	{OpDEX,1,2,AM_IMP,0},//0xCA DEX
+	{OpNOP,2,2,AM_IMM,0},//0xCB
+	{OpCPY,3,4,AM_ABS,0},//0xCC CPY abs
+	{OpCMP,3,4,AM_ABS,0},//0xCD CMP abs
+	{OpDEC,3,6,AM_ABS,0},//0xCE DEC abs
+	{OpNOP,3,6,AM_ABS,0},//0xCF
+	{OpBNE,2,2,AM_REL,0},//0xD0 BNE
+	{OpCMP,2,5,AM_IZY,1},//0xD1 CMP (zp),y
+	{OpNOP,1,2,AM_IMP,0},//0xD2
+	{OpNOP,2,8,AM_IZY,0},//0xD3
+	{OpNOP,2,4,AM_ZPX,0},//0xD4
+	{OpCMP,2,4,AM_ZPX,0},//0xD5 CMP zp,x
+	{OpDEC,2,6,AM_ZPX,0},//0xD6 DEC zp,x
+	{OpNOP,2,6,AM_ZPX,0},//0xD7
+	{OpCLD,1,2,AM_IMP,0},//0xD8 CLD
+	{OpCMP,3,4,AM_ABY,1},//0xD9 CMP abs,y
+	{OpNOP,1,2,AM_IMP,0},//0xDA
+	{OpNOP,3,7,AM_ABY,0},//0xDB
+	{OpNOP,3,4,AM_ABX,1},//0xDC
+	{OpCMP,3,4,AM_ABX,1},//0xDD CMP abs,x
+	{OpDEC,3,7,AM_ABX,0},//0xDE DEC abs,x
+	{OpNOP,3,7,AM_ABX,0},//0xDF
+	{OpCPX,2,2,AM_IMM,0},//0xE0 CPX #
+	{OpSBC,2,6,AM_IZX,0},//0xE1 SBC (zp,x)
+	{OpNOP,2,2,AM_IMM,0},//0xE2
+	{OpNOP,2,8,AM_IZX,0},//0xE3
+	{OpCPX,2,3,AM_ZPG,0},//0xE4 CPX zp
+	{OpSBC,2,3,AM_ZPG,0},//0xE5 SBC zp
+	{OpINC,2,5,AM_ZPG,0},//0xE6 INC zp
+	{OpNOP,2,5,AM_ZPG,0},//0xE7
+	{OpINX,1,2,AM_IMP,0},//0xE8 INX
+	{OpSBC,2,2,AM_IMM,0},//0xE9 SBC #
+	{OpNOP,1,2,AM_IMP,0},//0xEA NOP
+	{OpSBC,2,2,AM_IMM,0},//0xEB SBC # (unofficial copy of 0xE9)
+	{OpCPX,3,4,AM_ABS,0},//0xEC CPX abs
+	{OpSBC,3,4,AM_ABS,0},//0xED SBC abs
+	{OpINC,3,6,AM_ABS,0},//0xEE INC abs
+	{OpNOP,3,6,AM_ABS,0},//0xEF
+	{OpBEQ,2,2,AM_REL,0},//0xF0 BEQ
+	{OpSBC,2,5,AM_IZY,1},//0xF1 SBC (zp),y
+	{OpNOP,1,2,AM_IMP,0},//0xF2
+	{OpNOP,2,8,AM_IZY,0},//0xF3
+	{OpNOP,2,4,AM_ZPX,0},//0xF4
+	{OpSBC,2,4,AM_ZPX,0},//0xF5 SBC zp,x
+	{OpINC,2,6,AM_ZPX,0},//0xF6 INC zp,x
+	{OpNOP,2,6,AM_ZPX,0},//0xF7
+	{OpSED,1,2,AM_IMP,0},//0xF8 SED
+	{OpSBC,3,4,AM_ABY,1},//0xF9 SBC abs,y
+	{OpNOP,1,2,AM_IMP,0},//0xFA
+	{OpNOP,3,7,AM_ABY,0},//0xFB
+	{OpNOP,3,4,AM_ABX,1},//0xFC
+	{OpSBC,3,4,AM_ABX,1},//0xFD SBC abs,x
+	{OpINC,3,7,AM_ABX,0},//0xFE INC abs,x
+	{OpNOP,3,7,AM_ABX,0},//0xFF
+};
+//mnemonics, 3 letters for each opcode, unofficial ones are ---
+const char opnames[] =
+	"BRKORA---------ORAASL---PHPORAASL------ORAASL---"//00-0F
+	"BPLORA---------ORAASL---CLCORA---------ORAASL---"//10-1F
+	"JSRAND------BITANDROL---PLPANDROL---BITANDROL---"//20-2F
+	"BMIAND---------ANDROL---SECAND---------ANDROL---"//30-3F
+	"RTIEOR---------EORLSR---PHAEORLSR---JMPEORLSR---"//40-4F
+	"BVCEOR---------EORLSR---CLIEOR---------EORLSR---"//50-5F
+	"RTSADC---------ADCROR---PLAADCROR---JMPADCROR---"//60-6F
+	"BVSADC---------ADCROR---SEIADC---------ADCROR---"//70-7F
+	"---STA------STYSTASTX---DEY---TXA---STYSTASTX---"//80-8F
+	"BCCSTA------STYSTASTX---TYASTATXS------STA------"//90-9F
+	"LDYLDALDX---LDYLDALDX---TAYLDATAX---LDYLDALDX---"//A0-AF
+	"BCSLDA------LDYLDALDX---CLVLDATSX---LDYLDALDX---"//B0-BF
+	"CPYCMP------CPYCMPDEC---INYCMPDEX---CPYCMPDEC---"//C0-CF
+	"BNECMP---------CMPDEC---CLDCMP---------CMPDEC---"//D0-DF
+	"CPXSBC------CPXSBCINC---INXSBCNOPSBCCPXSBCINC---"//E0-EF
+	"BEQSBC---------SBCINC---SEDSBC---------SBCINC---";//F0-FF
+const char* amodenames[] = {"","A","#","zp","zp,x","zp,y","abs","abs,x","abs,y","(abs)","(zp,x)","(zp),y","rel"};
+
+uint16_t ResolveAddress(struct cpu* c, uint8_t amode, uint16_t abs){
+	//works out the effective address from the operand bytes, progcount still has to point at the opcode
+	uint8_t zp = abs & 0xFF;
+	uint16_t spos = 0;
+	switch (amode){
+		case AM_IMM:
+			return c->progcount + 1;
+		case AM_ZPG:
+			return zp;
+		case AM_ZPX:
+			return (uint8_t)(zp + c->x);//zero page indexing wraps inside the zero page
+		case AM_ZPY:
+			return (uint8_t)(zp + c->y);
+		case AM_ABS:
+			return abs;
+		case AM_ABX:
+			return abs + c->x;
+		case AM_ABY:
+			return abs + c->y;
+		case AM_IND:
+			//replicates a bug the 6502 has when fetching an indirect address at a page boundary
+			return ReadMemory(c,abs) + (ReadMemory(c,(abs & 0xFF00) | ((abs + 1) & 0x00FF)) << 8);
+		case AM_IZX:
+			zp += c->x;
+			return ReadMemory(c,zp) + (ReadMemory(c,(uint8_t)(zp + 1)) << 8);
+		case AM_IZY:
+			spos = ReadMemory(c,zp) + (ReadMemory(c,(uint8_t)(zp + 1)) << 8);
+			return spos + c->y;
+		case AM_REL:
+			return c->progcount + 2 + (int8_t)zp;//pc is incremented before any relative addressing is done.
 		default:
-			c->progcount = c->progcount + 1;
-			break;
+			return 0;
 	}
 }
 
-void RunSubset3Instructions(struct cpu* c, uint8_t op, uint8_t amode){
-	//these instructions typically concern the y register
-	uint8_t cpos = 0;//used for zero page addressing
-	uint16_t spos = 0;//used for addressing
-	int8_t temp = 0; //used for temporary math
-	uint8_t utemp = 0;//used for unsigned temporary math
-	switch (op){
-		case 0x01://BIT
-			switch(amode){
-				case 0://immediate
-					c->progcount+= 2;//illegal
-					break;
-				case 1://zero page
-					utemp = ReadMemory(c,c->instbuffer[1]);
-					SetPBit(c,VFLAG,utemp & 0x40);
-					SetPBit(c,NFLAG,utemp & 0x80);
-					utemp = utemp & c->acc;
-					SetPBit(c,ZFLAG,utemp);
-					c->progcount+= 2;
-					break;
-				case 3://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					utemp = ReadMemory(c,spos);
-					SetPBit(c,VFLAG,utemp & 0x40);
-					SetPBit(c,NFLAG,utemp & 0x80);
-					utemp = utemp & c->acc;
-					SetPBit(c,ZFLAG,utemp);
-					c->progcount+=3;
-					break;
-				case 5://zero page
-					c->progcount+= 2;//illegal operation
-					break;
-				case 7:
-					c->progcount+= 3;//illegal
-					break;
-				default:
-					c->progcount = c->progcount + 1;//illegal
-					break;
-			}
-			break;
-		case 0x02://JMP
-			switch(amode){
-				case 0://immediate
-					c->progcount+= 2;//illegal
-					break;
-				case 1://zero page
-					//illegal
-					c->progcount+= 2;
-					break;
-				case 3://indirect
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					//spos = ReadMemory(c,spos);
-					c->progcount = spos;
-					break;
-				case 5://zero page
-					c->progcount+= 2;//illegal operation
-					break;
-				case 7:
-					c->progcount+= 3;//illegal
-					break;
-				default:
-					c->progcount = c->progcount + 1;//illegal
-					break;
-			}
-			break;
-		case 0x03://JMP
-			switch(amode){
-				case 0://immediate
-				c->progcount+= 2;//illegal
-				break;
-				case 1://zero page
-				//illegal
-				c->progcount+= 2;
-				break;
-				case 3://indirect
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					//spos = ReadMemory(c,spos);
-					if ((spos & 0xFF) != 0xFF){
-						spos = (ReadMemory(c,spos+1)<<8) + ReadMemory(c,spos);
-					}
-					else{
-						spos = (ReadMemory(c,spos) + (ReadMemory(c,spos & 0xFF00) << 8) );//replicates a bug the 6502 has when fetching an indirect address at a page boundary
-					}
-					c->progcount = spos;
-					break;
-				case 5://zero page
-				c->progcount+= 2;//illegal operation
-				break;
-				case 7:
-				c->progcount+= 3;//illegal
-				break;
-				default:
-				c->progcount = c->progcount + 1;//illegal
-				break;
-			}
-			break;
-		case 0x04://STY
-			switch (amode){//addressing mode
-				case 0x00://immediate
-				//illegal
-				break;
-				case 0x01://zeropage
-				WriteMemory(c,c->instbuffer[1],c->y);
-				c->progcount += 2;
-				break;
-				case 0x02://immediate
-				//illegal
-				c->progcount += 2;
-				break;
-				case 0x03://absolute
-				spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-				WriteMemory(c,spos,c->y);
-				c->progcount += 3;
-				break;
-				case 0x04://indirect y
-				//illegal
-				c->progcount += 2;
-				break;
-				case 0x05://zeropage x
-					cpos = c->instbuffer[1] + c->x;
-					WriteMemory(c,cpos,c->y);
-					c->progcount += 2;
-					break;
-				case 0x06://absolute y
-				//illegal
-				c->progcount += 3;
-				break;
-				case 0x07://absolute x
-				//illegal
-				c->progcount += 3;
-				break;
-				default:
-				c->progcount = c->progcount + 1;
-				break;
-			}
-			break;
-		case 0x05://LDY
-			switch (amode){//addressing mode
-				case 0x00://immediate
-					c->y = c->instbuffer[1];
-					SetPBit(c,NFLAG,c->y & 0x80);
-					SetPBit(c,ZFLAG, c->y == 0x00);
-					c->progcount += 2;
-					break;
-				case 0x01://zeropage
-					c->y = ReadMemory(c,c->instbuffer[1]);
-					SetPBit(c,NFLAG,c->y & 0x80);
-					SetPBit(c,ZFLAG, c->y == 0x00);
-					c->progcount += 2;
-					break;
-				case 0x02://accumulator
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x03://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					c->y = ReadMemory(c,spos);
-					SetPBit(c,NFLAG,c->x & 0x80);
-					SetPBit(c,ZFLAG, c->x == 0x00);
-					c->progcount += 3;
-					break;
-				case 0x04://indirect y
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x05://zeropage x
-					cpos = c->instbuffer[1] + c->x;
-					c->y = ReadMemory(c,cpos);
-					SetPBit(c,NFLAG,c->y & 0x80);
-					SetPBit(c,ZFLAG, c->y == 0x00);
-					c->progcount += 2;
-					break;
-				case 0x06://absolute y
-					//illegal
-					c->progcount += 3;
-					break;
-				case 0x07://absolute x
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1] + c->x;
-					c->y = ReadMemory(c,spos);
-					SetPBit(c,NFLAG,c->y & 0x80);
-					SetPBit(c,ZFLAG, c->y == 0x00);
-					c->progcount += 3;
-					break;
-				default:
-					c->progcount = c->progcount + 1;
-					break;
-				}
-				break;
-		case 0x06://CPY
-			switch (amode){//addressing mode
-				case 0x00://immediate
-					temp = c->y - c->instbuffer[1];
-					SetPBit(c,NFLAG,temp & 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					SetPBit(c,CFLAG, temp >= 0);
-					c->progcount += 2;
-					break;
-				case 0x01://zeropage
-					temp = c->y - ReadMemory(c,c->instbuffer[1]);
-					SetPBit(c,NFLAG,temp & 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					SetPBit(c,CFLAG, temp >= 0);
-					c->progcount += 2;
-					break;
-				case 0x02:
-					c->progcount += 2;//illegal
-					break;
-				case 0x03://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					temp = c->y - ReadMemory(c,spos);
-					SetPBit(c,NFLAG,temp & 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					SetPBit(c,CFLAG, temp >= 0);
-					c->progcount += 3;
-					break;
-				case 0x04://indirect y
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x05://zeropage x
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x06://absolute y
-					//illegal
-					c->progcount += 3;
-					break;
-				case 0x07://absolute x
-					//illegal
-					c->progcount += 3;
-					break;
-				default:
-					c->progcount = c->progcount + 1;
-					break;
-			}
-			break;
-		case 0x07://CPX
-			switch (amode){//addressing mode
-				case 0x00://immediate
-					temp = c->x - c->instbuffer[1];
-					SetPBit(c,NFLAG,temp & 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					SetPBit(c,CFLAG, temp >= 0);
-					c->progcount += 2;
-					break;
-				case 0x01://zeropage
-					temp = c->x - ReadMemory(c,c->instbuffer[1]);
-					SetPBit(c,NFLAG,temp & 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					SetPBit(c,CFLAG, temp >= 0);
-					c->progcount += 2;
-					break;
-				case 0x02:
-					c->progcount += 2;//illegal
-					break;
-				case 0x03://absolute
-					spos = (c->instbuffer[2] << 8) + c->instbuffer[1];
-					temp = c->x - ReadMemory(c,spos);
-					SetPBit(c,NFLAG,temp & 0x80);
-					SetPBit(c,ZFLAG, temp == 0x00);
-					SetPBit(c,CFLAG, temp >= 0);
-					c->progcount += 3;
-					break;
-				case 0x04://indirect y
-					//illegal
-					c->progcount += 2;
-				break;
-				case 0x05://zeropage x
-					//illegal
-					c->progcount += 2;
-					break;
-				case 0x06://absolute y
-					//illegal
-					c->progcount += 3;
-					break;
-				case 0x07://absolute x
-					//illegal
-					c->progcount += 3;
-					break;
-				default:
-					c->progcount = c->progcount + 1;
-					break;
-			}
-			break;
-		default:
-			c->progcount = c->progcount + 1;
-			break;
+uint8_t PageCrossed(uint16_t addr, uint8_t index){//1 if adding index to get to addr went into the next page
+	return (((addr - index) ^ addr) & 0xFF00) != 0;
+}
+#ifdef PROFILE_CPU
+#if defined(THREADED_CPU) || defined(BLOCKCACHE_CPU) || defined(JIT_CPU)
+#error "the profiler only sees RunInstruction, build it with the table interpreter"
+#endif
+#include "profile.h"
+#endif
+uint8_t RunInstruction(struct cpu* c){
+	//runs one instruction, gives back the cycles it took
+	FetchInstruction(c);
+	const struct opcode* op = &opcodes[c->instbuffer[0]];
+	uint16_t addr = ResolveAddress(c,op->amode,(c->instbuffer[2] << 8) + c->instbuffer[1]);
+	if (c->trace){
+		TraceInstruction(c,op->cycles,addr);
 	}
+#ifdef PROFILE_CPU
+	uint16_t pc = c->progcount;
+	uint8_t depth = c->depth;
+#endif
+	c->progcount += op->length;
+	c->extracycles = op->pagecross ? PageCrossed(addr,op->amode == AM_ABX ? c->x : c->y) : 0;
+	op->exec(c,addr);
+#ifdef PROFILE_CPU
+	ProfileInstruction(c,pc,c->instbuffer[0],addr,depth,op->cycles + c->extracycles);
+#endif
+	return op->cycles + c->extracycles;
 }
+#if defined(THREADED_CPU)
+#define ENGINENAME "threaded"
+#elif defined(BLOCKCACHE_CPU)
+#define ENGINENAME "blocks"
+#elif defined(JIT_CPU)
+#define ENGINENAME "jit"
+#else
+#define ENGINENAME "table"
+#endif
+#ifdef THREADED_CPU
+#include "cputhreaded.h"
+#endif
+#ifdef BLOCKCACHE_CPU
+#include "blockcache.h"
+#endif
+#ifdef JIT_CPU
+#include "jit.h"
+#endif
 
-uint8_t RunConditionalBranches(struct cpu* c, uint8_t opcode){
-	//these opcodes dont fit in the 3 c=XX subsets
-	//so we return 1 if one of these opcodes match
-	uint8_t cpos = 0;//used for zero page addressing
-	int16_t spos = 0;//used for relative addressing
-	int8_t temp = 0; //used for temporary math
-	uint8_t utemp = 0;//used for unsigned temporary math
-	switch (opcode){
-		case 0x10://BPL
-			c->progcount+= 2;//pc is incremented before any relative addressing is done.
-			if (!GetPBit(c,NFLAG)){
-				temp = c->instbuffer[1];
-				spos = c->progcount + temp;
-				c->progcount = spos;
-			}
-			return 1;
-			break;
-		case 0x30: //BMI
-			c->progcount+= 2;
-			if (GetPBit(c,NFLAG)){
-				temp = c->instbuffer[1];
-				spos = c->progcount + temp;
-				c->progcount = spos;
-			}
-			return 1;
-			break;
-		case 0x50://BVC
-			c->progcount+= 2;
-			if (!GetPBit(c,VFLAG)){
-				temp = c->instbuffer[1];
-				spos = c->progcount + temp;
-				c->progcount = spos;
-			}
-			return 1;
-			break;
-		case 0x70://BVS
-			c->progcount+= 2;
-			if (GetPBit(c,VFLAG)){
-				temp = c->instbuffer[1];
-				spos = c->progcount + temp;
-				c->progcount = spos;
-			}
-			return 1;
-			break;
-		case 0x90://BCC
-			c->progcount+= 2;
-			if (!GetPBit(c,CFLAG)){
-				temp = c->instbuffer[1];
-				spos = c->progcount + temp;
-				c->progcount = spos;
-			}
-			return 1;
-			break;
-		case 0xB0://BCS
-			c->progcount+= 2;
-			if (GetPBit(c,CFLAG)){
-				temp = c->instbuffer[1];
-				spos = c->progcount + temp;
-				c->progcount = spos;
-			}
-			return 1;
-			break;
-		case 0xD0://BNE
-			c->progcount+= 2;
-			if (!GetPBit(c,ZFLAG)){
-				temp = c->instbuffer[1];
-				spos = c->progcount + temp;
-				c->progcount = spos;
-			}
-			return 1;
-			break;
-		case 0xF0://BEQ
-			c->progcount+= 2;
-			if (GetPBit(c,ZFLAG)){
-				temp = c->instbuffer[1];
-				spos = c->progcount + temp;
-				c->progcount = spos;
-			}
-			return 1;
-			break;
-		default:
-			return 0;
-			break;
+uint32_t RunFor(struct cpu* c, uint32_t cycles){
+	//runs until at least cycles have been used or play/init returns, gives back the cycles used
+	uint32_t used = 0;
+#if defined(THREADED_CPU)
+	used = RunForThreaded(c,cycles);
+#elif defined(BLOCKCACHE_CPU)
+	used = RunForBlocks(c,cycles);
+#elif defined(JIT_CPU)
+	used = RunForJit(c,cycles);
+#else
+	while (c->playing && used < cycles){
+		c->runused = used;
+		used += RunInstruction(c);
 	}
-	return 0;
+#endif
+	c->clocks += used;
+	return used;
 }
 
-uint8_t RunInterruptBranches(struct cpu* c, uint8_t opcode){
-	uint8_t cpos = 0;//used for zero page addressing
-	uint16_t spos = 0;//used for relative addressing
-	int8_t temp = 0; //used for temporary math
-	uint8_t utemp = 0;//used for unsigned temporary math
-	switch (opcode){
-		case 0x00://BRK
-			//this instructons probably shouldnt ever happen
-			c->progcount = c->progcount + 1;
-			PushStack(c,(c->progcount>>8)&0xFF);
-			PushStack(c,c->progcount&0xFF);
-			PushStack(c,c->status);
-			spos = (ReadMemory(c,0xFFFF) << 8)+ReadMemory(c,0xFFFE);
-			c->progcount = spos;
-			SetPBit(c,BFLAG,1);
-			return 1;
-			break;
-		case 0x20://JSR abs
-			spos = c->progcount + 2;
-			PushStack(c,(spos>>8)&0xFF);
-			PushStack(c,spos&0xFF);
-			//PushStack(c,c->status);
-			spos = (c->instbuffer[2]<<8) + c->instbuffer[1];
-			c->progcount = spos;
-			c->depth++;
-			return 1;
-			break;
-		case 0x40://rti
-			//this also probably shouldnt happen
-			c->status = PopStack(c);
-			spos = PopStack(c);
-			spos += PopStack(c) << 8;
-			c->progcount = spos;
-			return 1;
-			break;
-		case 0x60://RTS
-			if (c->depth){//we've run another subroutine from play/init
-				spos = PopStack(c);
-				spos += PopStack(c) << 8;
-				spos++;
-				c->progcount = spos;
-				c->depth--;
-				return 1;
-			}
-			else{//if we are returning from play/init
-				c->playing = 0;
-				return 1;
-			}
-			break;
-		default:
-			return 0;
-			break;
-		
+void RunCycles(struct cpu* c, uint32_t cycles){
+	//moves emulated time forward by cycles, running play/init while it is going and sitting idle once it returns
+	//the last instruction can run past the end, that gets taken off the next call so clocks doesnt drift
+	c->deadline += cycles;
+	while (c->playing && c->clocks < c->deadline){
+		RunFor(c,c->deadline - c->clocks);
+	}
+	if (c->clocks < c->deadline){
+		c->clocks = c->deadline;
 	}
 }
 
-uint8_t RunSingleByteInstructions(struct cpu* c, uint8_t opcode){
-	uint8_t cpos = 0;//used for zero page addressing
-	uint16_t spos = 0;//used for relative addressing
-	int8_t temp = 0; //used for temporary math
-	uint8_t utemp = 0;//used for unsigned temporary math
-	switch (opcode){
-		case 0x08://PHP
-			PushStack(c,c->status);
-			c->progcount = c->progcount + 1;
-			return 1;
-			break;
-		case 0x28://PHP
-			c->status = PopStack(c);
-			c->progcount = c->progcount + 1;
-			return 1;
-			break;
-		case 0x48://PHA
-			PushStack(c,c->acc);
-			c->progcount = c->progcount + 1;
-			return 1;
-			break;
-		case 0x68://PLA
-			c->acc = PopStack(c);
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			return 1;
-			break;
-		case 0x88://DEY
-			c->y--;
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->y & 0x80);
-			SetPBit(c,ZFLAG, c->y == 0x00);
-			return 1;
-			break;
-		case 0xA8://TAY
-			c->y = c->acc;
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->y & 0x80);
-			SetPBit(c,ZFLAG, c->y == 0x00);
-			return 1;
-			break;
-		case 0xC8://INY
-			c->y++;
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->y & 0x80);
-			SetPBit(c,ZFLAG, c->y == 0x00);
-			return 1;
-			break;
-		case 0xE8://INX
-			c->x++;
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->x & 0x80);
-			SetPBit(c,ZFLAG, c->x == 0x00);
-			return 1;
-			break;
-		case 0x18://CLC
-			c->progcount = c->progcount + 1;
-			SetPBit(c,CFLAG,0);
-			return 1;
-			break;
-		case 0x38://SEC
-			c->progcount = c->progcount + 1;
-			SetPBit(c,CFLAG,1);
-			return 1;
-			break;
-		case 0x58://CLI
-			c->progcount = c->progcount + 1;
-			SetPBit(c,IFLAG,0);
-			return 1;
-			break;
-		case 0x78://SEI
-			c->progcount = c->progcount + 1;
-			SetPBit(c,IFLAG,1);
-			return 1;
-			break;
-		case 0x98://TYA
-			c->acc = c->y;
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			return 1;
-			break;
-		case 0xB8://CLV
-			c->progcount = c->progcount + 1;
-			SetPBit(c,VFLAG,0);
-			return 1;
-			break;
-		case 0xD8://CLD
-			c->progcount = c->progcount + 1;
-			SetPBit(c,DFLAG,0);
-			return 1;
-			break;
-		case 0xF8://SED
-			c->progcount = c->progcount + 1;
-			SetPBit(c,DFLAG,1);
-			return 1;
-			break;
-		case 0x8A://TXA
-			c->acc = c->x;
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->acc & 0x80);
-			SetPBit(c,ZFLAG, c->acc == 0x00);
-			return 1;
-			break;
-		case 0x9A://TXS
-			c->s = c->x;
-			c->progcount = c->progcount + 1;
-			return 1;
-			break;
-		case 0xAA://TAX
-			c->x = c->acc;
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->x & 0x80);
-			SetPBit(c,ZFLAG, c->x == 0x00);
-			return 1;
-			break;
-		case 0xBA://TSX
-			c->x = c->s;
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->x & 0x80);
-			SetPBit(c,ZFLAG, c->x == 0x00);
-			return 1;
-			break;
-		case 0xCA://DEX
-			c->x--;
-			c->progcount = c->progcount + 1;
-			SetPBit(c,NFLAG,c->x & 0x80);
-			SetPBit(c,ZFLAG, c->x == 0x00);
-			return 1;
-			break;
-		case 0xEA://NOP
-			c->progcount = c->progcount + 1;
-			return 1;
-			break;
-		default:
-			return 0;
-			break;
+#define STATEVERSION 8 //bump whenever the fields in SyncState change
+#define STATESIZE 10497 //bytes a state takes, buffers passed to SaveState need at least this many
+#define STATELOAD 0 //what the save argument of SyncState and StateBytes can be
+#define STATESAVE 1
+#define STATEMEASURE 2 //touches nothing, only counts the bytes so they can be checked against STATESIZE
+uint8_t* StateBytes(uint8_t* p, void* field, uint16_t n, uint8_t save){//copies one field into or out of a state
+	uint8_t* f = (uint8_t*)field;
+	for (uint16_t i = 0; i < n && save != STATEMEASURE; i++){
+		if (save == STATESAVE){
+			p[i] = f[i];
+		}
+		else{
+			f[i] = p[i];
+		}
 	}
+	return p + n;
 }
-
-void RunInstruction(struct cpu* c){
-	FetchInstruction(c);
-	uint8_t inst = c->instbuffer[0];//instructions are indexed in the form "aaabbbcc"
-	//according to http://nparker.llx.com/a2/opcodes.html
-	uint8_t amode = (inst >> 2) & 0b00000111;//addressing mode
-	uint8_t op = (inst >> 5) & 0b00000111;//op code
-	if (RunConditionalBranches(c,inst) || RunInterruptBranches(c,inst) || RunSingleByteInstructions(c,inst)){
-		return;
+uint32_t SyncState(struct cpu* c, uint8_t* buf, uint8_t save){
+	//one list of fields for both directions so saving and loading cant drift apart, numbers are in host byte order
+	//the rom, page tables and decoded code arent saved, they get rebuilt from the rom and bank registers
+	uint8_t* p = buf + 1;//first byte is the version
+	uint8_t state = c->state;
+	p = StateBytes(p,&c->s,1,save);
+	p = StateBytes(p,&c->status,1,save);
+	p = StateBytes(p,&c->nzres,2,save);
+	p = StateBytes(p,&c->cres,2,save);
+	p = StateBytes(p,&c->vres,1,save);
+	p = StateBytes(p,&c->acc,1,save);
+	p = StateBytes(p,&c->x,1,save);
+	p = StateBytes(p,&c->y,1,save);
+	p = StateBytes(p,&c->depth,1,save);
+	p = StateBytes(p,&c->playing,1,save);
+	p = StateBytes(p,&c->progcount,2,save);
+	p = StateBytes(p,&c->playspeed,2,save);
+	p = StateBytes(p,&c->playadd,2,save);
+	p = StateBytes(p,&c->initadd,2,save);
+	p = StateBytes(p,&c->clocks,8,save);
+	p = StateBytes(p,&c->deadline,8,save);
+	p = StateBytes(p,&state,1,save);
+	p = StateBytes(p,c->bankregs,8,save);
+	p = StateBytes(p,c->RAM,ramsize,save);
+	p = StateBytes(p,c->workram,0x2000,save);
+	p = StateBytes(p,&c->a.ce,1,save);
+	p = StateBytes(p,&c->a.framecounter,1,save);
+	p = StateBytes(p,c->a.pulse1.regs,4,save);
+	p = StateBytes(p,&c->a.pulse1.lengthcount,1,save);
+	p = StateBytes(p,c->a.pulse2.regs,4,save);
+	p = StateBytes(p,&c->a.pulse2.lengthcount,1,save);
+	p = StateBytes(p,c->a.tri.regs,4,save);
+	p = StateBytes(p,&c->a.tri.phase,1,save);
+	p = StateBytes(p,&c->a.tri.lengthcount,1,save);
+	p = StateBytes(p,&c->a.samplerate,4,save);
+	p = StateBytes(p,&c->a.tri.wavephase,4,save);
+	p = StateBytes(p,&c->a.cyclefrac,8,save);
+	p = StateBytes(p,&c->a.tri.countdown,4,save);
+	p = StateBytes(p,&c->a.tri.linear,1,save);
+	p = StateBytes(p,&c->a.tri.linearreload,1,save);
+	struct pulsegen* pulses[2] = {&c->a.pulse1,&c->a.pulse2};
+	for (uint8_t i = 0; i < 2; i++){//where the pulses are and their envelopes
+		p = StateBytes(p,&pulses[i]->phase,4,save);
+		p = StateBytes(p,&pulses[i]->countdown,4,save);
+		p = StateBytes(p,&pulses[i]->step,1,save);
+		p = StateBytes(p,&pulses[i]->output,1,save);
+		p = StateBytes(p,&pulses[i]->envstart,1,save);
+		p = StateBytes(p,&pulses[i]->envdivider,1,save);
+		p = StateBytes(p,&pulses[i]->envdecay,1,save);
+	}
+	p = StateBytes(p,&c->a.mix,4,save);//the mixed output and the steps still coming out of it
+	p = StateBytes(p,c->a.out.buf,4 * BLEPBUFSIZE,save);
+	p = StateBytes(p,&c->a.out.pos,1,save);
+	p = StateBytes(p,&c->a.out.sum,4,save);
+	p = StateBytes(p,&c->a.dcin,4,save);
+	p = StateBytes(p,&c->a.dcout,4,save);
+	c->state = (enum CPUStatus)state;
+	return p - buf;
+}
+uint32_t SaveState(struct cpu* c, uint8_t* buf, uint32_t size){
+	//gives back the bytes written, 0 if buf is too small or SyncState has drifted from STATESIZE
+	if (size < STATESIZE || SyncState(c,buf,STATEMEASURE) != STATESIZE){
+		return 0;
 	}
-	if ((inst & 0x03) == 0x01){//cc == 01
-		RunSubset1Instructions(c,op,amode);
+	buf[0] = STATEVERSION;
+	return SyncState(c,buf,STATESAVE);
+}
+uint8_t LoadState(struct cpu* c, const uint8_t* buf, uint32_t size){
+	//c has to have the same rom loaded already, returns 1 if buf isnt a state this version can read
+	if (size < STATESIZE || buf[0] != STATEVERSION || SyncState(c,(uint8_t*)buf,STATEMEASURE) != STATESIZE){
+		return 1;
 	}
-	if ((inst & 0x03) == 0x02){//cc == 10
-		RunSubset2Instructions(c,op,amode);
+	SyncState(c,(uint8_t*)buf,STATELOAD);//only read from when loading
+	APUSetIncrements(&c->a);
+	if (c->rom && c->rom->banked){
+		for (uint8_t i = 0; i < 8; i++){
+			SwitchBank(c,i,c->bankregs[i]);
+		}
 	}
-	if ((inst & 0x03) == 0x00){//cc == 00
-		RunSubset3Instructions(c,op,amode);
+	c->extracycles = 0;
+	FlushCode(c);//memory came from somewhere else so nothing decoded before is safe to run
+	for (uint16_t i = 0; i < 0x100; i++){
+		c->dirtypages[i] = 1;
 	}
+	return 0;
+}
+
+void FreeCpu(struct cpu* c){//gives back whatever the engines allocated
+	free(c->blocks);
+	c->blocks = NULL;
+#ifdef PROFILE_CPU
+	ProfileReport(c,stderr);
+	free(c->prof);
+	c->prof = NULL;
+#endif
+#if defined(JIT_CPU)
+	FreeJit(c);
+#endif
 }
 
 void TickCpu(struct cpu* c){
@@ -1849,8 +1276,8 @@ void TickCpu(struct cpu* c){
 			c->state = waitrpi;
 			break;
 		case running:
-			RunInstruction(c);
+			RunFor(c,1);
 			break;
 	}
 }
-#endif /* CPU_H_ */
\ No newline at end of file
+#endif /* CPU_H_ */
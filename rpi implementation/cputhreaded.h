@@ -0,0 +1,1217 @@
+/*
+ * cputhreaded.h
+ *
+ * threaded version of the interpreter in cpu.h, built with -DTHREADED_CPU
+ * uses gcc labels as values so every handler jumps straight to the next one
+ * and the registers live in locals until RunForThreaded returns
+ */ 
+
+
+#ifndef CPUTHREADED_H_
+#define CPUTHREADED_H_
+#define MEMREAD(pos) ReadMemory(c,(pos))
+#define MEMWRITE(pos,val) c->runused = used - opcodes[op].cycles; \
+	WriteMemory(c,(pos),(val)); \
+	codepage = 0xFFFF //a write can switch banks under the code page, runused is where the instruction started for the apu log
+#define SETFLAG(pos,val) status = (val) ? (status | (0x01 << (pos))) : (status & ~(0x01 << (pos)))
+#define SETNZ(val) nzres = (uint8_t)(val)
+#define CARRY ((cres >> 8) & 0x01)
+#define GETSTATUS() (status | ((nzres | (nzres >> 8)) & 0x80) | ((vres >> 1) & 0x40) | ((!(nzres & 0xFF)) << ZFLAG) | CARRY)
+#define SETSTATUS(val) tmp = (val); \
+	status = tmp & ((0x01 << IFLAG) | (0x01 << DFLAG)); \
+	nzres = ((tmp & 0x80) << 8) | !(tmp & 0x02); \
+	cres = (tmp & 0x01) << 8; \
+	vres = (tmp & 0x40) << 1
+#define PUSH(val) s--; c->RAM[s+stackhead] = (val)
+#define POP() c->RAM[stackhead + (uint8_t)(s++)]
+#define ADC(inc) sum = acc + (inc) + CARRY; \
+	cres = sum; \
+	vres = ~(acc ^ (inc)) & (acc ^ sum); \
+	acc = sum & 0xFF; \
+	SETNZ(acc)
+#define COMPARE(reg) val = MEMREAD(ea); \
+	cres = 0x100 + (reg) - val; \
+	SETNZ(cres)
+#define BRANCH(cond) if (cond){ \
+		ea = pc + 2 + (int8_t)ip[1]; \
+		used += (((pc + 2) ^ ea) & 0xFF00) ? 2 : 1; \
+		pc = ea; \
+	} \
+	else{ \
+		pc += 2; \
+	}
+//effective address for each addressing mode, worked out before pc moves past the operands
+#define EA_IMM ea = pc + 1
+#define EA_ZPG ea = ip[1]
+#define EA_ZPX ea = (uint8_t)(ip[1] + x)
+#define EA_ZPY ea = (uint8_t)(ip[1] + y)
+#define EA_ABS ea = (ip[2] << 8) + ip[1]
+#define EA_ABX ea = (ip[2] << 8) + ip[1] + x
+#define EA_ABY ea = (ip[2] << 8) + ip[1] + y
+#define EA_IND ea = (ip[2] << 8) + ip[1]; \
+	ea = MEMREAD(ea) + (MEMREAD((ea & 0xFF00) | ((ea + 1) & 0x00FF)) << 8)
+#define EA_IZX val = ip[1] + x; \
+	ea = MEMREAD(val) + (MEMREAD((uint8_t)(val + 1)) << 8)
+#define EA_IZY val = ip[1]; \
+	ea = MEMREAD(val) + (MEMREAD((uint8_t)(val + 1)) << 8) + y
+#define PAGECROSS(index) used += PageCrossed(ea,(index))
+//ip points at the bytes of the current instruction, straight in the page it is in unless it hangs over the end of one
+//the page pointer is kept between instructions and dropped after every write, since a bank switch can move the page
+#define NEXT if (used >= cycles){ \
+		goto done; \
+	} \
+	if ((pc >> 8) == codepage && (pc & 0xFF) <= 0xFD){ \
+		ip = codeptr + (pc & 0xFF); \
+	} \
+	else if ((codeptr = c->readmap[pc >> 8]) && (pc & 0xFF) <= 0xFD){ \
+		codepage = pc >> 8; \
+		ip = codeptr + (pc & 0xFF); \
+	} \
+	else{ \
+		fetch[0] = MEMREAD(pc); \
+		fetch[1] = MEMREAD((uint16_t)(pc + 1)); \
+		fetch[2] = MEMREAD((uint16_t)(pc + 2)); \
+		codepage = 0xFFFF; \
+		ip = fetch; \
+	} \
+	op = ip[0]; \
+	used += opcodes[op].cycles; \
+	goto *dispatch[op]
+
+uint32_t RunForThreaded(struct cpu* c, uint32_t cycles){
+	//runs instructions until at least cycles have been used or play/init returns
+	static void* dispatch[256] = {
+		&&op_00,&&op_01,&&op_02,&&op_03,&&op_04,&&op_05,&&op_06,&&op_07,
+		&&op_08,&&op_09,&&op_0A,&&op_0B,&&op_0C,&&op_0D,&&op_0E,&&op_0F,
+		&&op_10,&&op_11,&&op_12,&&op_13,&&op_14,&&op_15,&&op_16,&&op_17,
+		&&op_18,&&op_19,&&op_1A,&&op_1B,&&op_1C,&&op_1D,&&op_1E,&&op_1F,
+		&&op_20,&&op_21,&&op_22,&&op_23,&&op_24,&&op_25,&&op_26,&&op_27,
+		&&op_28,&&op_29,&&op_2A,&&op_2B,&&op_2C,&&op_2D,&&op_2E,&&op_2F,
+		&&op_30,&&op_31,&&op_32,&&op_33,&&op_34,&&op_35,&&op_36,&&op_37,
+		&&op_38,&&op_39,&&op_3A,&&op_3B,&&op_3C,&&op_3D,&&op_3E,&&op_3F,
+		&&op_40,&&op_41,&&op_42,&&op_43,&&op_44,&&op_45,&&op_46,&&op_47,
+		&&op_48,&&op_49,&&op_4A,&&op_4B,&&op_4C,&&op_4D,&&op_4E,&&op_4F,
+		&&op_50,&&op_51,&&op_52,&&op_53,&&op_54,&&op_55,&&op_56,&&op_57,
+		&&op_58,&&op_59,&&op_5A,&&op_5B,&&op_5C,&&op_5D,&&op_5E,&&op_5F,
+		&&op_60,&&op_61,&&op_62,&&op_63,&&op_64,&&op_65,&&op_66,&&op_67,
+		&&op_68,&&op_69,&&op_6A,&&op_6B,&&op_6C,&&op_6D,&&op_6E,&&op_6F,
+		&&op_70,&&op_71,&&op_72,&&op_73,&&op_74,&&op_75,&&op_76,&&op_77,
+		&&op_78,&&op_79,&&op_7A,&&op_7B,&&op_7C,&&op_7D,&&op_7E,&&op_7F,
+		&&op_80,&&op_81,&&op_82,&&op_83,&&op_84,&&op_85,&&op_86,&&op_87,
+		&&op_88,&&op_89,&&op_8A,&&op_8B,&&op_8C,&&op_8D,&&op_8E,&&op_8F,
+		&&op_90,&&op_91,&&op_92,&&op_93,&&op_94,&&op_95,&&op_96,&&op_97,
+		&&op_98,&&op_99,&&op_9A,&&op_9B,&&op_9C,&&op_9D,&&op_9E,&&op_9F,
+		&&op_A0,&&op_A1,&&op_A2,&&op_A3,&&op_A4,&&op_A5,&&op_A6,&&op_A7,
+		&&op_A8,&&op_A9,&&op_AA,&&op_AB,&&op_AC,&&op_AD,&&op_AE,&&op_AF,
+		&&op_B0,&&op_B1,&&op_B2,&&op_B3,&&op_B4,&&op_B5,&&op_B6,&&op_B7,
+		&&op_B8,&&op_B9,&&op_BA,&&op_BB,&&op_BC,&&op_BD,&&op_BE,&&op_BF,
+		&&op_C0,&&op_C1,&&op_C2,&&op_C3,&&op_C4,&&op_C5,&&op_C6,&&op_C7,
+		&&op_C8,&&op_C9,&&op_CA,&&op_CB,&&op_CC,&&op_CD,&&op_CE,&&op_CF,
+		&&op_D0,&&op_D1,&&op_D2,&&op_D3,&&op_D4,&&op_D5,&&op_D6,&&op_D7,
+		&&op_D8,&&op_D9,&&op_DA,&&op_DB,&&op_DC,&&op_DD,&&op_DE,&&op_DF,
+		&&op_E0,&&op_E1,&&op_E2,&&op_E3,&&op_E4,&&op_E5,&&op_E6,&&op_E7,
+		&&op_E8,&&op_E9,&&op_EA,&&op_EB,&&op_EC,&&op_ED,&&op_EE,&&op_EF,
+		&&op_F0,&&op_F1,&&op_F2,&&op_F3,&&op_F4,&&op_F5,&&op_F6,&&op_F7,
+		&&op_F8,&&op_F9,&&op_FA,&&op_FB,&&op_FC,&&op_FD,&&op_FE,&&op_FF,
+	};
+	uint8_t acc = c->acc;
+	uint8_t x = c->x;
+	uint8_t y = c->y;
+	uint8_t s = c->s;
+	uint8_t status = c->status;
+	uint16_t nzres = c->nzres;
+	uint16_t cres = c->cres;
+	uint8_t vres = c->vres;
+	uint16_t pc = c->progcount;
+	uint32_t used = 0;
+	uint16_t ea = 0;
+	uint16_t sum = 0;
+	uint8_t val = 0;
+	uint8_t tmp = 0;
+	uint8_t op = 0;
+	const uint8_t* ip = NULL;
+	const uint8_t* codeptr = NULL;//readmap entry of codepage
+	uint16_t codepage = 0xFFFF;
+	uint8_t fetch[3];//instruction bytes that couldnt be pointed at directly
+	if (!c->playing){
+		return 0;
+	}
+	NEXT;
+	op_00://BRK
+		pc += 1;
+		PUSH(((pc + 1) >> 8) & 0xFF);
+		PUSH((pc + 1) & 0xFF);
+		PUSH(GETSTATUS() | 0x30);
+		SETFLAG(IFLAG,1);
+		pc = (MEMREAD(0xFFFF) << 8) + MEMREAD(0xFFFE);
+		NEXT;
+	op_01://ORA (zp,x)
+		EA_IZX;
+		pc += 2;
+		acc |= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_05://ORA zp
+		EA_ZPG;
+		pc += 2;
+		acc |= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_06://ASL zp
+		EA_ZPG;
+		pc += 2;
+		val = MEMREAD(ea);
+		cres = val << 1;
+		val = cres & 0xFF;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_08://PHP
+		pc += 1;
+		PUSH(GETSTATUS() | 0x30);
+		NEXT;
+	op_09://ORA #
+		EA_IMM;
+		pc += 2;
+		acc |= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_0A://ASL A
+		pc += 1;
+		cres = acc << 1;
+		acc = cres & 0xFF;
+		SETNZ(acc);
+		NEXT;
+	op_0D://ORA abs
+		EA_ABS;
+		pc += 3;
+		acc |= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_0E://ASL abs
+		EA_ABS;
+		pc += 3;
+		val = MEMREAD(ea);
+		cres = val << 1;
+		val = cres & 0xFF;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_10://BPL
+		BRANCH(!((nzres | (nzres >> 8)) & 0x80));
+		NEXT;
+	op_11://ORA (zp),y
+		EA_IZY;
+		PAGECROSS(y);
+		pc += 2;
+		acc |= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_15://ORA zp,x
+		EA_ZPX;
+		pc += 2;
+		acc |= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_16://ASL zp,x
+		EA_ZPX;
+		pc += 2;
+		val = MEMREAD(ea);
+		cres = val << 1;
+		val = cres & 0xFF;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_18://CLC
+		pc += 1;
+		cres = 0x000;
+		NEXT;
+	op_19://ORA abs,y
+		EA_ABY;
+		PAGECROSS(y);
+		pc += 3;
+		acc |= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_1D://ORA abs,x
+		EA_ABX;
+		PAGECROSS(x);
+		pc += 3;
+		acc |= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_1E://ASL abs,x
+		EA_ABX;
+		pc += 3;
+		val = MEMREAD(ea);
+		cres = val << 1;
+		val = cres & 0xFF;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_20://JSR
+		EA_ABS;
+		pc += 3;
+		PUSH(((pc - 1) >> 8) & 0xFF);
+		PUSH((pc - 1) & 0xFF);
+		pc = ea;
+		c->depth++;
+		NEXT;
+	op_21://AND (zp,x)
+		EA_IZX;
+		pc += 2;
+		acc &= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_24://BIT zp
+		EA_ZPG;
+		pc += 2;
+		val = MEMREAD(ea);
+		nzres = (val & acc) | ((val & 0x80) << 8);
+		vres = val << 1;
+		NEXT;
+	op_25://AND zp
+		EA_ZPG;
+		pc += 2;
+		acc &= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_26://ROL zp
+		EA_ZPG;
+		pc += 2;
+		val = MEMREAD(ea);
+		cres = (val << 1) | CARRY;
+		val = cres & 0xFF;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_28://PLP
+		pc += 1;
+		SETSTATUS(POP());
+		NEXT;
+	op_29://AND #
+		EA_IMM;
+		pc += 2;
+		acc &= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_2A://ROL A
+		pc += 1;
+		cres = (acc << 1) | CARRY;
+		acc = cres & 0xFF;
+		SETNZ(acc);
+		NEXT;
+	op_2C://BIT abs
+		EA_ABS;
+		pc += 3;
+		val = MEMREAD(ea);
+		nzres = (val & acc) | ((val & 0x80) << 8);
+		vres = val << 1;
+		NEXT;
+	op_2D://AND abs
+		EA_ABS;
+		pc += 3;
+		acc &= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_2E://ROL abs
+		EA_ABS;
+		pc += 3;
+		val = MEMREAD(ea);
+		cres = (val << 1) | CARRY;
+		val = cres & 0xFF;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_30://BMI
+		BRANCH((nzres | (nzres >> 8)) & 0x80);
+		NEXT;
+	op_31://AND (zp),y
+		EA_IZY;
+		PAGECROSS(y);
+		pc += 2;
+		acc &= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_35://AND zp,x
+		EA_ZPX;
+		pc += 2;
+		acc &= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_36://ROL zp,x
+		EA_ZPX;
+		pc += 2;
+		val = MEMREAD(ea);
+		cres = (val << 1) | CARRY;
+		val = cres & 0xFF;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_38://SEC
+		pc += 1;
+		cres = 0x100;
+		NEXT;
+	op_39://AND abs,y
+		EA_ABY;
+		PAGECROSS(y);
+		pc += 3;
+		acc &= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_3D://AND abs,x
+		EA_ABX;
+		PAGECROSS(x);
+		pc += 3;
+		acc &= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_3E://ROL abs,x
+		EA_ABX;
+		pc += 3;
+		val = MEMREAD(ea);
+		cres = (val << 1) | CARRY;
+		val = cres & 0xFF;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_40://RTI
+		pc += 1;
+		SETSTATUS(POP());
+		pc = POP();
+		pc += POP() << 8;
+		NEXT;
+	op_41://EOR (zp,x)
+		EA_IZX;
+		pc += 2;
+		acc ^= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_45://EOR zp
+		EA_ZPG;
+		pc += 2;
+		acc ^= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_46://LSR zp
+		EA_ZPG;
+		pc += 2;
+		val = MEMREAD(ea);
+		cres = (val & 0x01) << 8;
+		val = val >> 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_48://PHA
+		pc += 1;
+		PUSH(acc);
+		NEXT;
+	op_49://EOR #
+		EA_IMM;
+		pc += 2;
+		acc ^= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_4A://LSR A
+		pc += 1;
+		cres = (acc & 0x01) << 8;
+		acc = acc >> 1;
+		SETNZ(acc);
+		NEXT;
+	op_4C://JMP abs
+		EA_ABS;
+		pc += 3;
+		pc = ea;
+		NEXT;
+	op_4D://EOR abs
+		EA_ABS;
+		pc += 3;
+		acc ^= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_4E://LSR abs
+		EA_ABS;
+		pc += 3;
+		val = MEMREAD(ea);
+		cres = (val & 0x01) << 8;
+		val = val >> 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_50://BVC
+		BRANCH(!(vres & 0x80));
+		NEXT;
+	op_51://EOR (zp),y
+		EA_IZY;
+		PAGECROSS(y);
+		pc += 2;
+		acc ^= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_55://EOR zp,x
+		EA_ZPX;
+		pc += 2;
+		acc ^= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_56://LSR zp,x
+		EA_ZPX;
+		pc += 2;
+		val = MEMREAD(ea);
+		cres = (val & 0x01) << 8;
+		val = val >> 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_58://CLI
+		pc += 1;
+		SETFLAG(IFLAG,0);
+		NEXT;
+	op_59://EOR abs,y
+		EA_ABY;
+		PAGECROSS(y);
+		pc += 3;
+		acc ^= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_5D://EOR abs,x
+		EA_ABX;
+		PAGECROSS(x);
+		pc += 3;
+		acc ^= MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_5E://LSR abs,x
+		EA_ABX;
+		pc += 3;
+		val = MEMREAD(ea);
+		cres = (val & 0x01) << 8;
+		val = val >> 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_60://RTS
+		pc += 1;
+		if (c->depth){//we've run another subroutine from play/init
+			pc = POP();
+			pc += POP() << 8;
+			pc++;
+			c->depth--;
+		}
+		else{//if we are returning from play/init
+			c->playing = 0;
+			goto done;
+		}
+		NEXT;
+	op_61://ADC (zp,x)
+		EA_IZX;
+		pc += 2;
+		val = MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_65://ADC zp
+		EA_ZPG;
+		pc += 2;
+		val = MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_66://ROR zp
+		EA_ZPG;
+		pc += 2;
+		val = MEMREAD(ea);
+		tmp = CARRY;
+		cres = (val & 0x01) << 8;
+		val = (val >> 1) | (tmp << 7);
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_68://PLA
+		pc += 1;
+		acc = POP();
+		SETNZ(acc);
+		NEXT;
+	op_69://ADC #
+		EA_IMM;
+		pc += 2;
+		val = MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_6A://ROR A
+		pc += 1;
+		tmp = CARRY;
+		cres = (acc & 0x01) << 8;
+		acc = (acc >> 1) | (tmp << 7);
+		SETNZ(acc);
+		NEXT;
+	op_6C://JMP (abs)
+		EA_IND;
+		pc += 3;
+		pc = ea;
+		NEXT;
+	op_6D://ADC abs
+		EA_ABS;
+		pc += 3;
+		val = MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_6E://ROR abs
+		EA_ABS;
+		pc += 3;
+		val = MEMREAD(ea);
+		tmp = CARRY;
+		cres = (val & 0x01) << 8;
+		val = (val >> 1) | (tmp << 7);
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_70://BVS
+		BRANCH(vres & 0x80);
+		NEXT;
+	op_71://ADC (zp),y
+		EA_IZY;
+		PAGECROSS(y);
+		pc += 2;
+		val = MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_75://ADC zp,x
+		EA_ZPX;
+		pc += 2;
+		val = MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_76://ROR zp,x
+		EA_ZPX;
+		pc += 2;
+		val = MEMREAD(ea);
+		tmp = CARRY;
+		cres = (val & 0x01) << 8;
+		val = (val >> 1) | (tmp << 7);
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_78://SEI
+		pc += 1;
+		SETFLAG(IFLAG,1);
+		NEXT;
+	op_79://ADC abs,y
+		EA_ABY;
+		PAGECROSS(y);
+		pc += 3;
+		val = MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_7D://ADC abs,x
+		EA_ABX;
+		PAGECROSS(x);
+		pc += 3;
+		val = MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_7E://ROR abs,x
+		EA_ABX;
+		pc += 3;
+		val = MEMREAD(ea);
+		tmp = CARRY;
+		cres = (val & 0x01) << 8;
+		val = (val >> 1) | (tmp << 7);
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_81://STA (zp,x)
+		EA_IZX;
+		pc += 2;
+		MEMWRITE(ea,acc);
+		NEXT;
+	op_84://STY zp
+		EA_ZPG;
+		pc += 2;
+		MEMWRITE(ea,y);
+		NEXT;
+	op_85://STA zp
+		EA_ZPG;
+		pc += 2;
+		MEMWRITE(ea,acc);
+		NEXT;
+	op_86://STX zp
+		EA_ZPG;
+		pc += 2;
+		MEMWRITE(ea,x);
+		NEXT;
+	op_88://DEY
+		pc += 1;
+		y--;
+		SETNZ(y);
+		NEXT;
+	op_8A://TXA
+		pc += 1;
+		acc = x;
+		SETNZ(acc);
+		NEXT;
+	op_8C://STY abs
+		EA_ABS;
+		pc += 3;
+		MEMWRITE(ea,y);
+		NEXT;
+	op_8D://STA abs
+		EA_ABS;
+		pc += 3;
+		MEMWRITE(ea,acc);
+		NEXT;
+	op_8E://STX abs
+		EA_ABS;
+		pc += 3;
+		MEMWRITE(ea,x);
+		NEXT;
+	op_90://BCC
+		BRANCH(!(cres & 0x100));
+		NEXT;
+	op_91://STA (zp),y
+		EA_IZY;
+		pc += 2;
+		MEMWRITE(ea,acc);
+		NEXT;
+	op_94://STY zp,x
+		EA_ZPX;
+		pc += 2;
+		MEMWRITE(ea,y);
+		NEXT;
+	op_95://STA zp,x
+		EA_ZPX;
+		pc += 2;
+		MEMWRITE(ea,acc);
+		NEXT;
+	op_96://STX zp,y
+		EA_ZPY;
+		pc += 2;
+		MEMWRITE(ea,x);
+		NEXT;
+	op_98://TYA
+		pc += 1;
+		acc = y;
+		SETNZ(acc);
+		NEXT;
+	op_99://STA abs,y
+		EA_ABY;
+		pc += 3;
+		MEMWRITE(ea,acc);
+		NEXT;
+	op_9A://TXS
+		pc += 1;
+		s = x;
+		NEXT;
+	op_9D://STA abs,x
+		EA_ABX;
+		pc += 3;
+		MEMWRITE(ea,acc);
+		NEXT;
+	op_A0://LDY #
+		EA_IMM;
+		pc += 2;
+		y = MEMREAD(ea);
+		SETNZ(y);
+		NEXT;
+	op_A1://LDA (zp,x)
+		EA_IZX;
+		pc += 2;
+		acc = MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_A2://LDX #
+		EA_IMM;
+		pc += 2;
+		x = MEMREAD(ea);
+		SETNZ(x);
+		NEXT;
+	op_A4://LDY zp
+		EA_ZPG;
+		pc += 2;
+		y = MEMREAD(ea);
+		SETNZ(y);
+		NEXT;
+	op_A5://LDA zp
+		EA_ZPG;
+		pc += 2;
+		acc = MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_A6://LDX zp
+		EA_ZPG;
+		pc += 2;
+		x = MEMREAD(ea);
+		SETNZ(x);
+		NEXT;
+	op_A8://TAY
+		pc += 1;
+		y = acc;
+		SETNZ(y);
+		NEXT;
+	op_A9://LDA #
+		EA_IMM;
+		pc += 2;
+		acc = MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_AA://TAX
+		pc += 1;
+		x = acc;
+		SETNZ(x);
+		NEXT;
+	op_AC://LDY abs
+		EA_ABS;
+		pc += 3;
+		y = MEMREAD(ea);
+		SETNZ(y);
+		NEXT;
+	op_AD://LDA abs
+		EA_ABS;
+		pc += 3;
+		acc = MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_AE://LDX abs
+		EA_ABS;
+		pc += 3;
+		x = MEMREAD(ea);
+		SETNZ(x);
+		NEXT;
+	op_B0://BCS
+		BRANCH(cres & 0x100);
+		NEXT;
+	op_B1://LDA (zp),y
+		EA_IZY;
+		PAGECROSS(y);
+		pc += 2;
+		acc = MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_B4://LDY zp,x
+		EA_ZPX;
+		pc += 2;
+		y = MEMREAD(ea);
+		SETNZ(y);
+		NEXT;
+	op_B5://LDA zp,x
+		EA_ZPX;
+		pc += 2;
+		acc = MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_B6://LDX zp,y
+		EA_ZPY;
+		pc += 2;
+		x = MEMREAD(ea);
+		SETNZ(x);
+		NEXT;
+	op_B8://CLV
+		pc += 1;
+		vres = 0x00;
+		NEXT;
+	op_B9://LDA abs,y
+		EA_ABY;
+		PAGECROSS(y);
+		pc += 3;
+		acc = MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_BA://TSX
+		pc += 1;
+		x = s;
+		SETNZ(x);
+		NEXT;
+	op_BC://LDY abs,x
+		EA_ABX;
+		PAGECROSS(x);
+		pc += 3;
+		y = MEMREAD(ea);
+		SETNZ(y);
+		NEXT;
+	op_BD://LDA abs,x
+		EA_ABX;
+		PAGECROSS(x);
+		pc += 3;
+		acc = MEMREAD(ea);
+		SETNZ(acc);
+		NEXT;
+	op_BE://LDX abs,y
+		EA_ABY;
+		PAGECROSS(y);
+		pc += 3;
+		x = MEMREAD(ea);
+		SETNZ(x);
+		NEXT;
+	op_C0://CPY #
+		EA_IMM;
+		pc += 2;
+		COMPARE(y);
+		NEXT;
+	op_C1://CMP (zp,x)
+		EA_IZX;
+		pc += 2;
+		COMPARE(acc);
+		NEXT;
+	op_C4://CPY zp
+		EA_ZPG;
+		pc += 2;
+		COMPARE(y);
+		NEXT;
+	op_C5://CMP zp
+		EA_ZPG;
+		pc += 2;
+		COMPARE(acc);
+		NEXT;
+	op_C6://DEC zp
+		EA_ZPG;
+		pc += 2;
+		val = MEMREAD(ea) - 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_C8://INY
+		pc += 1;
+		y++;
+		SETNZ(y);
+		NEXT;
+	op_C9://CMP #
+		EA_IMM;
+		pc += 2;
+		COMPARE(acc);
+		NEXT;
+	op_CA://DEX
+		pc += 1;
+		x--;
+		SETNZ(x);
+		NEXT;
+	op_CC://CPY abs
+		EA_ABS;
+		pc += 3;
+		COMPARE(y);
+		NEXT;
+	op_CD://CMP abs
+		EA_ABS;
+		pc += 3;
+		COMPARE(acc);
+		NEXT;
+	op_CE://DEC abs
+		EA_ABS;
+		pc += 3;
+		val = MEMREAD(ea) - 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_D0://BNE
+		BRANCH(nzres & 0xFF);
+		NEXT;
+	op_D1://CMP (zp),y
+		EA_IZY;
+		PAGECROSS(y);
+		pc += 2;
+		COMPARE(acc);
+		NEXT;
+	op_D5://CMP zp,x
+		EA_ZPX;
+		pc += 2;
+		COMPARE(acc);
+		NEXT;
+	op_D6://DEC zp,x
+		EA_ZPX;
+		pc += 2;
+		val = MEMREAD(ea) - 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_D8://CLD
+		pc += 1;
+		SETFLAG(DFLAG,0);
+		NEXT;
+	op_D9://CMP abs,y
+		EA_ABY;
+		PAGECROSS(y);
+		pc += 3;
+		COMPARE(acc);
+		NEXT;
+	op_DD://CMP abs,x
+		EA_ABX;
+		PAGECROSS(x);
+		pc += 3;
+		COMPARE(acc);
+		NEXT;
+	op_DE://DEC abs,x
+		EA_ABX;
+		pc += 3;
+		val = MEMREAD(ea) - 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_E0://CPX #
+		EA_IMM;
+		pc += 2;
+		COMPARE(x);
+		NEXT;
+	op_E1://SBC (zp,x)
+		EA_IZX;
+		pc += 2;
+		val = ~MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_E4://CPX zp
+		EA_ZPG;
+		pc += 2;
+		COMPARE(x);
+		NEXT;
+	op_E5://SBC zp
+		EA_ZPG;
+		pc += 2;
+		val = ~MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_E6://INC zp
+		EA_ZPG;
+		pc += 2;
+		val = MEMREAD(ea) + 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_E8://INX
+		pc += 1;
+		x++;
+		SETNZ(x);
+		NEXT;
+	op_E9://SBC #
+		EA_IMM;
+		pc += 2;
+		val = ~MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_EB://SBC # (unofficial copy of 0xE9)
+		EA_IMM;
+		pc += 2;
+		val = ~MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_EC://CPX abs
+		EA_ABS;
+		pc += 3;
+		COMPARE(x);
+		NEXT;
+	op_ED://SBC abs
+		EA_ABS;
+		pc += 3;
+		val = ~MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_EE://INC abs
+		EA_ABS;
+		pc += 3;
+		val = MEMREAD(ea) + 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_F0://BEQ
+		BRANCH(!(nzres & 0xFF));
+		NEXT;
+	op_F1://SBC (zp),y
+		EA_IZY;
+		PAGECROSS(y);
+		pc += 2;
+		val = ~MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_F5://SBC zp,x
+		EA_ZPX;
+		pc += 2;
+		val = ~MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_F6://INC zp,x
+		EA_ZPX;
+		pc += 2;
+		val = MEMREAD(ea) + 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_F8://SED
+		pc += 1;
+		SETFLAG(DFLAG,1);
+		NEXT;
+	op_F9://SBC abs,y
+		EA_ABY;
+		PAGECROSS(y);
+		pc += 3;
+		val = ~MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_FD://SBC abs,x
+		EA_ABX;
+		PAGECROSS(x);
+		pc += 3;
+		val = ~MEMREAD(ea);
+		ADC(val);
+		NEXT;
+	op_FE://INC abs,x
+		EA_ABX;
+		pc += 3;
+		val = MEMREAD(ea) + 1;
+		MEMWRITE(ea,val);
+		SETNZ(val);
+		NEXT;
+	op_02:
+	op_12:
+	op_1A:
+	op_22:
+	op_32:
+	op_3A:
+	op_42:
+	op_52:
+	op_5A:
+	op_62:
+	op_72:
+	op_7A:
+	op_92:
+	op_B2:
+	op_D2:
+	op_DA:
+	op_EA:
+	op_F2:
+	op_FA://nop and unofficial opcodes, 1 byte
+		pc += 1;
+		NEXT;
+	op_03:
+	op_04:
+	op_07:
+	op_0B:
+	op_13:
+	op_14:
+	op_17:
+	op_23:
+	op_27:
+	op_2B:
+	op_33:
+	op_34:
+	op_37:
+	op_43:
+	op_44:
+	op_47:
+	op_4B:
+	op_53:
+	op_54:
+	op_57:
+	op_63:
+	op_64:
+	op_67:
+	op_6B:
+	op_73:
+	op_74:
+	op_77:
+	op_80:
+	op_82:
+	op_83:
+	op_87:
+	op_89:
+	op_8B:
+	op_93:
+	op_97:
+	op_A3:
+	op_A7:
+	op_AB:
+	op_B7:
+	op_C2:
+	op_C3:
+	op_C7:
+	op_CB:
+	op_D3:
+	op_D4:
+	op_D7:
+	op_E2:
+	op_E3:
+	op_E7:
+	op_F3:
+	op_F4:
+	op_F7://nop and unofficial opcodes, 2 bytes
+		pc += 2;
+		NEXT;
+	op_B3://unofficial opcodes that read, they still pay for crossing a page
+		EA_IZY;
+		PAGECROSS(y);
+		pc += 2;
+		NEXT;
+	op_0C:
+	op_0F:
+	op_1B:
+	op_1F:
+	op_2F:
+	op_3B:
+	op_3F:
+	op_4F:
+	op_5B:
+	op_5F:
+	op_6F:
+	op_7B:
+	op_7F:
+	op_8F:
+	op_9B:
+	op_9C:
+	op_9E:
+	op_9F:
+	op_AF:
+	op_CF:
+	op_DB:
+	op_DF:
+	op_EF:
+	op_FB:
+	op_FF://nop and unofficial opcodes, 3 bytes
+		pc += 3;
+		NEXT;
+	op_1C:
+	op_3C:
+	op_5C:
+	op_7C:
+	op_DC:
+	op_FC://unofficial opcodes that read, they still pay for crossing a page
+		EA_ABX;
+		PAGECROSS(x);
+		pc += 3;
+		NEXT;
+	op_BB:
+	op_BF://unofficial opcodes that read, they still pay for crossing a page
+		EA_ABY;
+		PAGECROSS(y);
+		pc += 3;
+		NEXT;
+	done:
+	c->acc = acc;
+	c->x = x;
+	c->y = y;
+	c->s = s;
+	c->status = status;
+	c->nzres = nzres;
+	c->cres = cres;
+	c->vres = vres;
+	c->progcount = pc;
+	return used;
+}
+#undef MEMREAD
+#undef MEMWRITE
+#undef SETFLAG
+#undef SETNZ
+#undef CARRY
+#undef GETSTATUS
+#undef SETSTATUS
+#undef PUSH
+#undef POP
+#undef ADC
+#undef COMPARE
+#undef BRANCH
+#undef EA_IMM
+#undef EA_ZPG
+#undef EA_ZPX
+#undef EA_ZPY
+#undef EA_ABS
+#undef EA_ABX
+#undef EA_ABY
+#undef EA_IND
+#undef EA_IZX
+#undef EA_IZY
+#undef PAGECROSS
+#undef NEXT
+#endif /* CPUTHREADED_H_ */
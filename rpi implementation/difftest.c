@@ -0,0 +1,210 @@
+/*
+ * difftest.c
+ *
+ * runs a song on RunInstruction and on the engine it is built with (make difftest ENGINE=...) side by side
+ * and stops at the first point where the two cpus dont match
+ * usage: difftest [-n instructions] [-t trace.bin] file.nsf [song] [frames]
+ * the cpus are compared every -n reference instructions (1 by default), on a mismatch the registers and ram
+ * that differ are printed with the last instructions the reference ran, and its whole trace is written to -t
+ * the jit only runs a compiled block when the whole block fits in what it was asked for, so give it a bigger -n
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "cpu.h"
+#define DIFFFRAMES 3600 //play calls checked by default, a minute of music
+#define DIFFMAXCYCLES 1000000 //a call that runs longer than this is cut off on both cpus
+#define DIFFCHASE 1000 //instructions one side can run trying to land on the same cycle as the other
+#define DIFFCONTEXT 16 //reference instructions printed before a mismatch
+#define DIFFSHOWN 16 //bytes of differing memory printed
+
+uint8_t Chase(struct cpu* ref, struct cpu* fast){
+	//runs whichever cpu is behind until both are at the same cycle, returns 1 if they never line up
+	//the engines can stop a few instructions past what they were asked for, so this is how they get back in step
+	for (uint32_t i = 0; i < DIFFCHASE; i++){
+		if (ref->clocks == fast->clocks || (!ref->playing && !fast->playing)){
+			return 0;
+		}
+		if (ref->clocks < fast->clocks){
+			if (!ref->playing){
+				return 1;
+			}
+			ref->clocks += RunInstruction(ref);
+		}
+		else{
+			if (!fast->playing){
+				return 1;
+			}
+			RunFor(fast,ref->clocks - fast->clocks);
+		}
+	}
+	return 1;
+}
+
+uint16_t DiffBytes(const char* name, uint16_t base, const uint8_t* a, const uint8_t* b, uint16_t n){
+	//prints where a and b differ, gives back how many bytes do
+	uint16_t count = 0;
+	for (uint32_t i = 0; i < n; i++){
+		if (a[i] != b[i]){
+			if (count < DIFFSHOWN){
+				printf("  %s $%04X: reference %02X, %s %02X\n",name,base + i,a[i],ENGINENAME,b[i]);
+			}
+			count++;
+		}
+	}
+	if (count > DIFFSHOWN){
+		printf("  %s: %d more bytes differ\n",name,count - DIFFSHOWN);
+	}
+	return count;
+}
+
+uint32_t Compare(struct cpu* ref, struct cpu* fast, uint8_t print){//returns how many things differ
+	uint8_t r[11] = {ref->acc,ref->x,ref->y,ref->s,GetStatus(ref),ref->progcount & 0xFF,ref->progcount >> 8,ref->depth,ref->playing,ref->a.ce,ref->a.framecounter};
+	uint8_t f[11] = {fast->acc,fast->x,fast->y,fast->s,GetStatus(fast),fast->progcount & 0xFF,fast->progcount >> 8,fast->depth,fast->playing,fast->a.ce,fast->a.framecounter};
+	const char* names[11] = {"a","x","y","s","p","pc low","pc high","depth","playing","apu $4015","apu $4017"};
+	uint32_t count = ref->clocks != fast->clocks;
+	if (count && print){
+		printf("  clocks: reference %llu, %s %llu\n",(unsigned long long)ref->clocks,ENGINENAME,(unsigned long long)fast->clocks);
+	}
+	for (uint8_t i = 0; i < 11; i++){
+		if (r[i] != f[i]){
+			if (print){
+				printf("  %s: reference %02X, %s %02X\n",names[i],r[i],ENGINENAME,f[i]);
+			}
+			count++;
+		}
+	}
+	if (!print){//quick check first, only worth walking the bytes when something is off
+		return count || memcmp(ref->RAM,fast->RAM,ramsize) || memcmp(ref->workram,fast->workram,0x2000) || memcmp(ref->bankregs,fast->bankregs,8)
+			|| memcmp(ref->a.pulse1.regs,fast->a.pulse1.regs,4) || memcmp(ref->a.pulse2.regs,fast->a.pulse2.regs,4) || memcmp(ref->a.tri.regs,fast->a.tri.regs,4);
+	}
+	count += DiffBytes("ram",0x0000,ref->RAM,fast->RAM,ramsize);
+	count += DiffBytes("workram",0x6000,ref->workram,fast->workram,0x2000);
+	count += DiffBytes("bank",0x5FF8,ref->bankregs,fast->bankregs,8);
+	count += DiffBytes("apu",0x4000,ref->a.pulse1.regs,fast->a.pulse1.regs,4);
+	count += DiffBytes("apu",0x4004,ref->a.pulse2.regs,fast->a.pulse2.regs,4);
+	count += DiffBytes("apu",0x4008,ref->a.tri.regs,fast->a.tri.regs,4);
+	return count;
+}
+
+void PrintContext(const struct trace* t){//the last DIFFCONTEXT instructions the reference ran, oldest first
+	uint32_t shown = 0;
+	uint32_t i = t->head;
+	while (shown < DIFFCONTEXT && i != t->head - TRACESIZE && i != 0){//walk back to where the context starts
+		i--;
+		if (t->entries[i & (TRACESIZE - 1)].kind == TRACEINST){
+			shown++;
+		}
+	}
+	printf("last instructions on the reference:\n");
+	for (; i != t->head; i++){
+		const struct traceentry* e = &t->entries[i & (TRACESIZE - 1)];
+		if (e->kind == TRACEINST){
+			printf("  %04X  %.3s  %02X %02X  A:%02X X:%02X Y:%02X S:%02X P:%02X\n",e->pc,&opnames[e->op * 3],e->operand[0],e->operand[1],
+				e->acc,e->x,e->y,e->s,e->p);
+		}
+		else{
+			printf("        write $%04X = %02X\n",e->pc,e->op);
+		}
+	}
+}
+
+uint8_t Call(struct cpu* ref, struct cpu* fast, int32_t frame, uint32_t every, uint64_t* checked){
+	//runs play call frame on both cpus, or init when frame is -1, returns 1 at the first mismatch
+	uint64_t start = ref->clocks;
+	ref->progcount = frame < 0 ? ref->initadd : ref->playadd;
+	fast->progcount = ref->progcount;
+	ref->playing = 1;
+	fast->playing = 1;
+	while (ref->playing && ref->clocks - start < DIFFMAXCYCLES){
+		uint32_t used = 0;
+		for (uint32_t i = 0; i < every && ref->playing; i++){
+			used += RunInstruction(ref);
+		}
+		ref->clocks += used;
+		if (fast->playing){
+			RunFor(fast,used);
+		}
+		uint8_t lost = Chase(ref,fast);
+		(*checked)++;
+		if (lost || Compare(ref,fast,0)){
+			printf("%s differs from the reference at cycle %llu, %llu checks in\n",ENGINENAME,(unsigned long long)ref->clocks,(unsigned long long)*checked);
+			if (frame < 0){
+				printf("  in init\n");
+			}
+			else{
+				printf("  in play call %d\n",frame);
+			}
+			if (lost){
+				printf("  the two never got back to the same cycle\n");
+			}
+			Compare(ref,fast,1);
+			PrintContext(ref->trace);
+			return 1;
+		}
+	}
+	ref->playing = 0;
+	fast->playing = 0;
+	return 0;
+}
+
+int main(int argc, char** argv){
+	uint32_t every = 1;
+	const char* tracepath = "difftest.bin";
+	int arg = 1;
+	while (arg + 1 < argc && argv[arg][0] == '-'){
+		if (!strcmp(argv[arg],"-n")){
+			every = atoi(argv[arg + 1]);
+		}
+		else if (!strcmp(argv[arg],"-t")){
+			tracepath = argv[arg + 1];
+		}
+		else{
+			break;
+		}
+		arg += 2;
+	}
+	if (arg >= argc || argc - arg > 3 || every == 0){
+		printf("usage: %s [-n instructions] [-t trace.bin] file.nsf [song] [frames]\n",argv[0]);
+		return 1;
+	}
+	struct rom* r = OpenROM(argv[arg]);
+	if (!r){
+		return 1;
+	}
+	uint8_t song = argc - arg > 1 ? atoi(argv[arg + 1]) : (r->startingsong ? r->startingsong - 1 : 0);
+	uint32_t frames = argc - arg > 2 ? atoi(argv[arg + 2]) : DIFFFRAMES;
+	static struct cpu ref;
+	static struct cpu fast;
+	static struct trace t;
+	struct cpu* cpus[2] = {&ref,&fast};
+	for (uint8_t i = 0; i < 2; i++){
+		APUInit(&(cpus[i]->a));
+		InitCpu(cpus[i]);
+		LoadROM(cpus[i],r);
+		cpus[i]->acc = song;
+		cpus[i]->x = 0;//ntsc
+	}
+	ref.trace = &t;
+	uint64_t checked = 0;
+	uint8_t failed = Call(&ref,&fast,-1,every,&checked);
+	for (uint32_t i = 0; i < frames && !failed; i++){
+		failed = Call(&ref,&fast,i,every,&checked);
+	}
+	if (failed){
+		if (TraceDump(&t,tracepath)){
+			printf("could not write %s\n",tracepath);
+		}
+		else{
+			printf("whole reference trace written to %s\n",tracepath);
+		}
+	}
+	else{
+		printf("%s matched the reference over init and %u play calls of song %d, %llu checks\n",ENGINENAME,frames,song,(unsigned long long)checked);
+	}
+	FreeCpu(&ref);
+	FreeCpu(&fast);
+	CloseROM(r);
+	return failed;
+}
@@ -0,0 +1,382 @@
+/*
+ * jit.h
+ *
+ * x86-64 recompiler for cpu.h, built with -DJIT_CPU
+ * blocks of play/init code that run often get turned into native code in an mmap'd arena,
+ * simple instructions are done inline and everything else calls the normal handlers
+ * anything the recompiler cant handle and any block that isnt hot yet goes through RunInstruction
+ */
+
+
+#ifndef JIT_H_
+#define JIT_H_
+#include <stddef.h>
+#include <sys/mman.h>
+#if !defined(__x86_64__)
+#error "the jit engine only generates x86-64 code"
+#endif
+#define JITCACHESIZE 1024 //number of blocks kept, has to be a power of 2
+#define JITARENASIZE 0x100000 //1MB of executable memory per cpu
+#define JITMAXLEN 64 //most instructions we put in one block
+#define JITMAXINSTBYTES 64 //most bytes of native code one instruction can turn into
+#define JITTHRESHOLD 16 //times a block has to be interpreted before we compile it
+#define JITNOCOMPILE 0xFFFF //hits value for blocks that start with something we cant compile
+
+typedef uint32_t (*jitfunc)(struct cpu* c);//returns cycles used, 0 if a guard failed before anything ran
+struct jitblock{
+	jitfunc code;
+	uint16_t start;//pc the block starts at
+	uint16_t hits;//times we interpreted it
+	uint32_t cycles;//cycles the whole block takes
+};
+struct jitcache{
+	uint8_t* arena;
+	size_t used;
+	struct jitblock blocks[JITCACHESIZE];
+};
+
+void Emit8(uint8_t** p, uint8_t val){
+	*(*p)++ = val;
+}
+void Emit16(uint8_t** p, uint16_t val){
+	Emit8(p,val & 0xFF);
+	Emit8(p,val >> 8);
+}
+void Emit32(uint8_t** p, uint32_t val){
+	Emit16(p,val & 0xFFFF);
+	Emit16(p,val >> 16);
+}
+void Emit64(uint8_t** p, uint64_t val){
+	Emit32(p,val & 0xFFFFFFFF);
+	Emit32(p,val >> 32);
+}
+//all the struct cpu accesses are [rbx+disp32], reg is the 3 bit register/opcode extension field
+void EmitRbxOperand(uint8_t** p, uint8_t reg, size_t off){
+	Emit8(p,0x80 | (reg << 3) | 0x03);
+	Emit32(p,off);
+}
+void EmitStoreImm16(uint8_t** p, size_t off, uint16_t val){//mov word [rbx+off], val
+	Emit8(p,0x66);
+	Emit8(p,0xC7);
+	EmitRbxOperand(p,0,off);
+	Emit16(p,val);
+}
+void EmitStoreImm32(uint8_t** p, size_t off, uint32_t val){//mov dword [rbx+off], val
+	Emit8(p,0xC7);
+	EmitRbxOperand(p,0,off);
+	Emit32(p,val);
+}
+void EmitStorePC(uint8_t** p, uint16_t pc){
+	EmitStoreImm16(p,offsetof(struct cpu,progcount),pc);
+}
+void EmitExitIfChanged(uint8_t** p, uint32_t gen, uint32_t used){
+	//leaves the block if a write flushed the code we are running from
+	Emit8(p,0x81);//cmp dword [rbx+codegen], gen
+	EmitRbxOperand(p,7,offsetof(struct cpu,codegen));
+	Emit32(p,gen);
+	Emit8(p,0x74);//je over the exit
+	Emit8(p,used ? 0x07 : 0x04);
+	if (used){
+		Emit8(p,0xB8);//mov eax, used
+		Emit32(p,used);
+	}
+	else{
+		Emit8(p,0x31);//xor eax, eax
+		Emit8(p,0xC0);
+	}
+	Emit8(p,0x5B);//pop rbx
+	Emit8(p,0xC3);//ret
+}
+void EmitBankGuard(uint8_t** p, uint8_t slot, uint8_t bank){
+	Emit8(p,0x80);//cmp byte [rbx+bankregs+slot], bank
+	EmitRbxOperand(p,7,offsetof(struct cpu,bankregs) + slot);
+	Emit8(p,bank);
+	Emit8(p,0x74);//je over the bail out
+	Emit8(p,0x04);
+	Emit8(p,0x31);//xor eax, eax
+	Emit8(p,0xC0);
+	Emit8(p,0x5B);//pop rbx
+	Emit8(p,0xC3);//ret
+}
+void EmitCall(uint8_t** p, void* fn){
+	Emit8(p,0x48);//mov rax, fn
+	Emit8(p,0xB8);
+	Emit64(p,(uint64_t)(uintptr_t)fn);
+	Emit8(p,0xFF);//call rax
+	Emit8(p,0xD0);
+}
+void EmitLoadReg(uint8_t** p, size_t off){//movzx eax, byte [rbx+off]
+	Emit8(p,0x0F);
+	Emit8(p,0xB6);
+	EmitRbxOperand(p,0,off);
+}
+void EmitStoreReg(uint8_t** p, size_t off){//mov byte [rbx+off], al
+	Emit8(p,0x88);
+	EmitRbxOperand(p,0,off);
+}
+void EmitSetNZ(uint8_t** p){
+	//the result in eax is already zero extended so it just becomes nzres
+	Emit8(p,0x66);//mov word [rbx+nzres], ax
+	Emit8(p,0x89);
+	EmitRbxOperand(p,0,offsetof(struct cpu,nzres));
+}
+void EmitStatusOp(uint8_t** p, uint8_t ext, uint8_t mask){//and/or byte [rbx+status], mask
+	Emit8(p,0x80);
+	EmitRbxOperand(p,ext,offsetof(struct cpu,status));
+	Emit8(p,mask);
+}
+void EmitStoreImm(uint8_t** p, size_t off, uint8_t val){//mov byte [rbx+off], val
+	Emit8(p,0xC6);
+	EmitRbxOperand(p,0,off);
+	Emit8(p,val);
+}
+
+uint8_t CompileBranch(uint8_t** p, void (*exec)(struct cpu* c, uint16_t addr), uint16_t taken, uint16_t nottaken){
+	//flags are tested straight from the lazy fields, skipifnonzero is 1 when a nonzero test means not taken
+	uint8_t skipifnonzero = 0;
+	EmitStorePC(p,nottaken);
+	if (exec == OpBPL || exec == OpBMI){//test word [rbx+nzres], 0x8080
+		Emit8(p,0x66);
+		Emit8(p,0xF7);
+		EmitRbxOperand(p,0,offsetof(struct cpu,nzres));
+		Emit16(p,0x8080);
+		skipifnonzero = exec == OpBPL;
+	}
+	else{
+		size_t off = 0;
+		uint8_t mask = 0;
+		if (exec == OpBVC || exec == OpBVS){off = offsetof(struct cpu,vres); mask = 0x80; skipifnonzero = exec == OpBVC;}
+		else if (exec == OpBCC || exec == OpBCS){off = offsetof(struct cpu,cres) + 1; mask = 0x01; skipifnonzero = exec == OpBCC;}
+		else if (exec == OpBNE || exec == OpBEQ){off = offsetof(struct cpu,nzres); mask = 0xFF; skipifnonzero = exec == OpBEQ;}
+		else{return 0;}
+		Emit8(p,0xF6);//test byte [rbx+off], mask
+		EmitRbxOperand(p,0,off);
+		Emit8(p,mask);
+	}
+	Emit8(p,skipifnonzero ? 0x75 : 0x74);//jnz/jz over the taken path
+	Emit8(p,0x10);
+	EmitStorePC(p,taken);
+	Emit8(p,0x80);//add byte [rbx+extracycles], taken cycles
+	EmitRbxOperand(p,0,offsetof(struct cpu,extracycles));
+	Emit8(p,((taken ^ nottaken) & 0xFF00) ? 2 : 1);
+	return 1;
+}
+
+uint8_t CompileInline(uint8_t** p, const struct opcode* op, uint16_t operand){
+	//does the simple register only instructions without a call, returns 0 if op needs its handler
+	void (*exec)(struct cpu* c, uint16_t addr) = op->exec;
+	size_t reg = 0;
+	if (op->amode == AM_IMM && (exec == OpLDA || exec == OpLDX || exec == OpLDY)){
+		uint8_t val = operand & 0xFF;
+		reg = exec == OpLDA ? offsetof(struct cpu,acc) : exec == OpLDX ? offsetof(struct cpu,x) : offsetof(struct cpu,y);
+		EmitStoreImm(p,reg,val);
+		EmitStoreImm16(p,offsetof(struct cpu,nzres),val);
+		return 1;
+	}
+	if (op->amode == AM_ZPG && (exec == OpLDA || exec == OpLDX || exec == OpLDY)){
+		reg = exec == OpLDA ? offsetof(struct cpu,acc) : exec == OpLDX ? offsetof(struct cpu,x) : offsetof(struct cpu,y);
+		EmitLoadReg(p,offsetof(struct cpu,RAM) + (operand & 0xFF));
+		EmitStoreReg(p,reg);
+		EmitSetNZ(p);
+		return 1;
+	}
+	if (exec == OpINX || exec == OpDEX || exec == OpINY || exec == OpDEY){
+		reg = (exec == OpINX || exec == OpDEX) ? offsetof(struct cpu,x) : offsetof(struct cpu,y);
+		EmitLoadReg(p,reg);
+		Emit8(p,0xFE);//inc al / dec al
+		Emit8(p,(exec == OpINX || exec == OpINY) ? 0xC0 : 0xC8);
+		EmitStoreReg(p,reg);
+		EmitSetNZ(p);
+		return 1;
+	}
+	size_t from = 0;
+	uint8_t transfer = 1;//cant go by reg being set, s is at offset 0
+	if (exec == OpTAX){from = offsetof(struct cpu,acc); reg = offsetof(struct cpu,x);}
+	else if (exec == OpTAY){from = offsetof(struct cpu,acc); reg = offsetof(struct cpu,y);}
+	else if (exec == OpTXA){from = offsetof(struct cpu,x); reg = offsetof(struct cpu,acc);}
+	else if (exec == OpTYA){from = offsetof(struct cpu,y); reg = offsetof(struct cpu,acc);}
+	else if (exec == OpTSX){from = offsetof(struct cpu,s); reg = offsetof(struct cpu,x);}
+	else if (exec == OpTXS){from = offsetof(struct cpu,x); reg = offsetof(struct cpu,s);}
+	else{transfer = 0;}
+	if (transfer){
+		EmitLoadReg(p,from);
+		EmitStoreReg(p,reg);
+		if (exec != OpTXS){
+			EmitSetNZ(p);
+		}
+		return 1;
+	}
+	if (exec == OpCLC){EmitStoreImm16(p,offsetof(struct cpu,cres),0x000); return 1;}
+	if (exec == OpSEC){EmitStoreImm16(p,offsetof(struct cpu,cres),0x100); return 1;}
+	if (exec == OpCLI){EmitStatusOp(p,4,~(0x01 << IFLAG)); return 1;}
+	if (exec == OpSEI){EmitStatusOp(p,1,0x01 << IFLAG); return 1;}
+	if (exec == OpCLD){EmitStatusOp(p,4,~(0x01 << DFLAG)); return 1;}
+	if (exec == OpSED){EmitStatusOp(p,1,0x01 << DFLAG); return 1;}
+	if (exec == OpCLV){EmitStoreImm(p,offsetof(struct cpu,vres),0x00); return 1;}
+	if (exec == OpNOP && !op->pagecross){return 1;}//the reading ones still have to work out their address
+	return 0;
+}
+
+uint8_t WritesMemory(void (*exec)(struct cpu* c, uint16_t addr)){
+	return exec == OpSTA || exec == OpSTX || exec == OpSTY || exec == OpASL || exec == OpLSR ||
+		exec == OpROL || exec == OpROR || exec == OpINC || exec == OpDEC;
+}
+
+uint16_t ResolveAddressTimed(struct cpu* c, uint8_t amode, uint16_t abs){//ResolveAddress that also charges the page crossing cycle
+	uint16_t addr = ResolveAddress(c,amode,abs);
+	c->extracycles += PageCrossed(addr,amode == AM_ABX ? c->x : c->y);
+	return addr;
+}
+
+void CompileBlock(struct cpu* c, struct jitblock* b, uint16_t pc){
+	struct jitcache* j = c->jit;
+	if (j->used + JITMAXLEN*JITMAXINSTBYTES + 64 > JITARENASIZE){//arena is full so start over
+		for (uint16_t i = 0; i < JITCACHESIZE; i++){
+			j->blocks[i].code = NULL;
+			j->blocks[i].hits = 0;
+		}
+		j->used = 0;
+	}
+	uint8_t* start = j->arena + j->used;
+	uint8_t* p = start;
+	uint32_t used = 0;
+	uint8_t count = 0;
+	uint8_t pcset = 0;//1 once the last instruction left progcount where the block should continue
+	uint16_t next = pc;
+	Emit8(&p,0x53);//push rbx
+	Emit8(&p,0x48);//mov rbx, rdi
+	Emit8(&p,0x89);
+	Emit8(&p,0xFB);
+	EmitExitIfChanged(&p,c->codegen,0);//guard against code written since we compiled
+	if (pc >= 0x8000){//guard against bank switches, a block covers at most two 4KB banks
+		uint8_t slot = (pc >> 12) - 8;
+		EmitBankGuard(&p,slot,c->bankregs[slot]);
+		if (slot < 7){
+			EmitBankGuard(&p,slot + 1,c->bankregs[slot + 1]);
+		}
+	}
+	else if (pc >= 0x7000){//a block near the top of ram can run on into bank slot 0
+		EmitBankGuard(&p,0,c->bankregs[0]);
+	}
+	while (count < JITMAXLEN){
+		const struct opcode* op = &opcodes[ReadMemory(c,pc)];
+		uint16_t operand = (ReadMemory(c,pc+2) << 8) + ReadMemory(c,pc+1);
+		if (op->exec == OpBRK || op->exec == OpRTI){//left to the interpreter
+			break;
+		}
+		next = pc + op->length;
+		used += op->cycles;
+		pcset = 0;
+		MarkCodePage(c,pc);
+		MarkCodePage(c,next - 1);
+		if (op->amode == AM_REL){
+			CompileBranch(&p,op->exec,next + (int8_t)(operand & 0xFF),next);
+			pcset = 1;
+		}
+		else if (op->exec == OpJMP && op->amode == AM_ABS){
+			EmitStorePC(&p,operand);
+			pcset = 1;
+		}
+		else if (!CompileInline(&p,op,operand)){
+			EmitStorePC(&p,next);
+			pcset = 1;
+			Emit8(&p,0x48);//mov rdi, rbx
+			Emit8(&p,0x89);
+			Emit8(&p,0xDF);
+			if (op->amode == AM_IMM || op->amode == AM_ZPG || op->amode == AM_ABS){
+				Emit8(&p,0xBE);//mov esi, effective address
+				Emit32(&p,op->amode == AM_IMM ? pc + 1 : op->amode == AM_ZPG ? (operand & 0xFF) : operand);
+			}
+			else if (op->amode != AM_IMP && op->amode != AM_ACC){//indexed and indirect modes
+				Emit8(&p,0xBE);//mov esi, amode
+				Emit32(&p,op->amode);
+				Emit8(&p,0xBA);//mov edx, operand
+				Emit32(&p,operand);
+				EmitCall(&p,op->pagecross ? (void*)ResolveAddressTimed : (void*)ResolveAddress);
+				Emit8(&p,0x48);//mov rdi, rbx
+				Emit8(&p,0x89);
+				Emit8(&p,0xDF);
+				Emit8(&p,0x89);//mov esi, eax
+				Emit8(&p,0xC6);
+			}
+			if (WritesMemory(op->exec)){//where this instruction starts in the block, for stamping apu writes
+				EmitStoreImm32(&p,offsetof(struct cpu,blockused),used - op->cycles);
+			}
+			EmitCall(&p,(void*)op->exec);
+			if (WritesMemory(op->exec)){
+				EmitExitIfChanged(&p,c->codegen,used);
+			}
+		}
+		count++;
+		if (op->amode == AM_REL || op->exec == OpJMP || op->exec == OpJSR || op->exec == OpRTS){
+			break;
+		}
+		pc = next;
+	}
+	if (!count){//first instruction was something we leave to the interpreter
+		b->hits = JITNOCOMPILE;
+		return;
+	}
+	if (!pcset){
+		EmitStorePC(&p,next);
+	}
+	Emit8(&p,0xB8);//mov eax, used
+	Emit32(&p,used);
+	Emit8(&p,0x5B);//pop rbx
+	Emit8(&p,0xC3);//ret
+	j->used += p - start;
+	b->code = (jitfunc)start;
+	b->cycles = used;
+}
+
+uint32_t RunForJit(struct cpu* c, uint32_t cycles){
+	//runs until at least cycles have been used or play/init returns, gives back the cycles used
+	uint32_t used = 0;
+	if (!c->jit){
+		c->jit = (struct jitcache*)calloc(1,sizeof(struct jitcache));
+		c->jit->arena = (uint8_t*)mmap(NULL,JITARENASIZE,PROT_READ | PROT_WRITE | PROT_EXEC,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+		if (c->jit->arena == MAP_FAILED){
+			c->jit->arena = NULL;
+		}
+	}
+	while (c->playing && used < cycles){
+		struct jitblock* b = &c->jit->blocks[c->progcount & (JITCACHESIZE-1)];
+		if (b->start != c->progcount){
+			b->start = c->progcount;
+			b->code = NULL;
+			b->hits = 0;
+		}
+		if (b->code && cycles - used >= b->cycles){//a block only runs if its base cycles fit in what we were asked for
+			c->extracycles = 0;
+			c->runused = used;
+			uint32_t ran = b->code(c);
+			if (ran){
+				used += ran + c->extracycles;
+				continue;
+			}
+			b->code = NULL;//a guard failed, recompile once it gets hot again
+			b->hits = 0;
+		}
+		if (!b->code && b->hits != JITNOCOMPILE && ++b->hits >= JITTHRESHOLD && c->jit->arena){
+			CompileBlock(c,b,c->progcount);
+			if (b->code){
+				continue;
+			}
+		}
+		c->runused = used;
+		c->blockused = 0;
+		used += RunInstruction(c);
+	}
+	return used;
+}
+void FreeJit(struct cpu* c){
+	if (!c->jit){
+		return;
+	}
+	if (c->jit->arena){
+		munmap(c->jit->arena,JITARENASIZE);
+	}
+	free(c->jit);
+	c->jit = NULL;
+}
+#endif /* JIT_H_ */
@@ -0,0 +1,128 @@
+/*
+ * loop.h
+ *
+ * finds where a song starts repeating by hashing the machine at the start of every play call
+ * once the music driver is back in a state it has been in before, everything after it repeats too
+ * only pages written since the last play call get hashed again, so it costs next to nothing per frame
+ */
+
+
+#ifndef LOOP_H_
+#define LOOP_H_
+#include "cpu.h"
+#define LOOPHASHPRIME 0x100000001B3ULL //fnv-1a
+#define LOOPHASHSEED 0xCBF29CE484222325ULL
+#define LOOPPAGES 0x28 //the 8 ram pages and then the 32 work ram pages
+
+struct loopentry{
+	uint64_t hash;//0 for an empty slot
+	uint32_t frame;
+};
+struct loopfinder{
+	uint64_t pagehash[LOOPPAGES];//hash of every page as of its last write
+	uint8_t primed;//0 until every page has been hashed once
+	struct loopentry* table;//every state seen so far, open addressing
+	uint32_t tablesize;//power of 2
+	uint32_t used;
+	uint8_t found;
+	uint32_t introframes;//play calls before the loop starts
+	uint32_t loopframes;//play calls in one time through the loop, 0 until found
+};
+
+uint64_t LoopHash(uint64_t h, const uint8_t* bytes, uint16_t n){
+	for (uint16_t i = 0; i < n; i++){
+		h = (h ^ bytes[i]) * LOOPHASHPRIME;
+	}
+	return h;
+}
+
+void LoopInit(struct loopfinder* l){
+	l->tablesize = 0x400;
+	l->table = (struct loopentry*)calloc(l->tablesize,sizeof(struct loopentry));
+	l->used = 0;
+	l->primed = 0;
+	l->found = 0;
+	l->introframes = 0;
+	l->loopframes = 0;
+}
+
+void LoopFree(struct loopfinder* l){
+	free(l->table);
+	l->table = NULL;
+}
+
+struct loopentry* LoopSlot(struct loopentry* table, uint32_t size, uint64_t hash){//where hash is or would go
+	uint32_t i = hash & (size - 1);
+	while (table[i].hash && table[i].hash != hash){
+		i = (i + 1) & (size - 1);
+	}
+	return &table[i];
+}
+
+uint64_t LoopStateHash(struct loopfinder* l, struct cpu* c){
+	//ram mirrors all land on the same 8 pages, the stack page is left to the live part below
+	for (uint16_t i = 0; i < 8; i++){
+		if (i != 1 && (!l->primed || c->dirtypages[i] | c->dirtypages[i + 8] | c->dirtypages[i + 0x10] | c->dirtypages[i + 0x18])){
+			l->pagehash[i] = LoopHash(LOOPHASHSEED,&c->RAM[i << 8],0x100);
+		}
+	}
+	for (uint16_t i = 0; i < 0x20; i++){
+		if (!l->primed || c->dirtypages[0x60 + i]){
+			l->pagehash[8 + i] = LoopHash(LOOPHASHSEED,&c->workram[i << 8],0x100);
+		}
+	}
+	for (uint16_t i = 0; i < 0x100; i++){
+		c->dirtypages[i] = 0;
+	}
+	l->primed = 1;
+	uint64_t h = LOOPHASHSEED;
+	for (uint16_t i = 0; i < LOOPPAGES; i++){
+		if (i != 1){
+			h = LoopHash(h,(const uint8_t*)&l->pagehash[i],8);
+		}
+	}
+	//anything under the stack pointer is left over from earlier calls and doesnt matter
+	h = LoopHash(h,&c->RAM[stackhead + c->s + 1],0xFF - c->s);
+	h = LoopHash(h,c->bankregs,8);
+	//just the registers, length counters and the frame counter step arent lined up with play calls
+	h = LoopHash(h,c->a.pulse1.regs,4);
+	h = LoopHash(h,c->a.pulse2.regs,4);
+	h = LoopHash(h,c->a.tri.regs,4);
+	return h ? h : 1;
+}
+
+uint8_t LoopFrame(struct loopfinder* l, struct cpu* c, uint32_t frame){
+	//call right before play call number frame starts, returns 1 on the call that finds the loop
+	uint64_t h = LoopStateHash(l,c);
+	if (l->found || !l->table){
+		return 0;
+	}
+	struct loopentry* e = LoopSlot(l->table,l->tablesize,h);
+	if (e->hash){
+		l->found = 1;
+		l->introframes = e->frame;
+		l->loopframes = frame - e->frame;
+		return 1;
+	}
+	e->hash = h;
+	e->frame = frame;
+	l->used++;
+	if (l->used * 2 > l->tablesize){//keep it at most half full
+		uint32_t size = l->tablesize * 2;
+		struct loopentry* table = (struct loopentry*)calloc(size,sizeof(struct loopentry));
+		if (!table){//out of memory, stop looking
+			LoopFree(l);
+			return 0;
+		}
+		for (uint32_t i = 0; i < l->tablesize; i++){
+			if (l->table[i].hash){
+				*LoopSlot(table,size,l->table[i].hash) = l->table[i];
+			}
+		}
+		free(l->table);
+		l->table = table;
+		l->tablesize = size;
+	}
+	return 0;
+}
+#endif /* LOOP_H_ */
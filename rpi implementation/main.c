@@ -12,12 +12,9 @@
 #include <time.h>
 #include <bcm2835.h>
 #include <signal.h>
- #include "cpu.h"
+ #include "player.h"
 #define AMPDIV 2
-#define SAMPLESPERFRAMECOUNTER 34
-#define SECONDSPERPLAYCALL .01664
-#define SECONDSPERSAMPLE .0000625
-#define SECONDSPERFRAMECOUNTER .004166
+#define SAMPLESPERSECOND 16000
 static volatile int keepRunning = 1;
 void intHandler(int dummy){
 	keepRunning = 0;
@@ -44,101 +41,38 @@ int InitSPI(){
 }
 
 
+double SecondsSince(struct timeval* since){
+	struct timeval now, total;
+	gettimeofday(&now,NULL);
+	timersub(&now,since,&total);
+	return total.tv_sec + (total.tv_usec*.000001);
+}
+
 int main(void)
 {
 	if (InitSPI()){return 1;}
-	struct cpu c;
-	APUInit(&(c.a));
-	
-	InitCpu(&c);
-	c.playing = 1;
-	c.progcount = c.initadd;
-	c.acc = 0;
-	c.x = 0;
-	c.y = 0x00;
-	//clock_t start, end, startSample, endSample;
-	struct timeval start,end, total, startsample,endsample,totalsample, startfc,endfc,totalfc;
-	double cpu_time_used;
-	//start = clock();
+	static struct player p;
+	struct timeval start;
+	gettimeofday(&start,NULL);
+	struct rom* r = OpenROM("smb.nsf");
+	if (!r){return 1;}
+	if (PlayerInit(&p,r,PLAYERDEFAULTSONG,SAMPLESPERSECOND)){return 1;}
+#ifdef TRACE_PLAYER
+	static struct trace t;//what ran last ends up in trace.bin if we crash or get SIGUSR1, costs a few stores per instruction so only with make TRACE=1
+	p.c.trace = &t;
+	TraceOnSignal(&t,"trace.bin");
+#endif
+	printf("%s\n%s\n%s\n",r->songname,r->artistname,r->copyright);
+	printf("time taken for init: %f\n",SecondsSince(&start));
 	gettimeofday(&start,NULL);
-	while (c.playing){
-		TickCpu(&c);
-	}
-	unsigned short pos = 0;
-	/*while (pos < 0x0800){
-		for (unsigned char i = 0; i < 0x10; i++){
-			printf("%02X",c.RAM[pos+i]);
-			printf(" ");
-		}
-		printf("\n");
-		pos += 0x0010;
-	}*/
-	//end = clock();
-	gettimeofday(&end,NULL);
-	timersub(&end,&start,&total);
-	cpu_time_used = total.tv_sec + (total.tv_usec*.000001f);//((double)(end-start))/CLOCKS_PER_SEC;
-	printf("time taken for init: %f\n",cpu_time_used);
-	c.progcount = c.playadd;
-	c.playing = 1;
-	uint8_t amp = 0;
-	uint8_t tickcnt = 0;
-	uint8_t framecountercnt = 0;
-	cpu_time_used = 0;
-	float sampletime = 0.0;
-	double globalSampleTime = 0.0;
-	double frameCounterTime = 0.0;
-	gettimeofday(&startsample,NULL);
     while (keepRunning)  
     {
-		gettimeofday(&end,NULL);
-		timersub(&end,&start,&total);
-		gettimeofday(&start,NULL);
-		cpu_time_used += total.tv_sec + (total.tv_usec*.000001f);
-		if (cpu_time_used > SECONDSPERPLAYCALL){
-			if (!c.playing){
-			//	printf("finished a playcall at %f seconds\n", cpu_time_used);
-				c.playing = 1;
-				c.progcount = c.playadd;
-				cpu_time_used = 0.0;
-			}
-		}
-		if (c.playing){
-			TickCpu(&c);
-		}
-		
-		
-		gettimeofday(&endsample,NULL);
-		timersub(&endsample,&startsample,&totalsample);
-		sampletime += totalsample.tv_sec + (totalsample.tv_usec*.000001f);
-		gettimeofday(&startsample,NULL);
-		if (sampletime >= SECONDSPERSAMPLE){
-			globalSampleTime += sampletime;
-			float samplerec = SampleAPUSquare1(&(c.a), globalSampleTime);
-			samplerec+= .5;
-			SampleAPUSquare2(&(c.a),globalSampleTime);
-			SampleAPUTriangle(&(c.a),globalSampleTime);
-			if (samplerec > 1.0){samplerec = 1.0;}
-			if (samplerec < 0.0){samplerec = 0.0;}
-			int8_t sample8bit = samplerec *127;
-			sample8bit += 128;
-			//printf("sample taken: %d \n", sample8bit);
-			bcm2835_spi_transfer(sample8bit);
-			//bcm2835_pwm_set_data(0,sample12bit>>6 & 0xFF);
-			//bcm2835_pwm_set_data(1,sample12bit & 0xFF);
-			sampletime = 0.0;
-		}
-		
-		
-		gettimeofday(&endfc,NULL);
-		timersub(&endfc,&startfc,&totalfc);
-		frameCounterTime += totalfc.tv_sec + (totalfc.tv_usec*.000001f);
-		gettimeofday(&startfc,NULL);
-		if (frameCounterTime >= SECONDSPERFRAMECOUNTER){
-			APUFrameStep(&(c.a));
-			frameCounterTime = 0.0;
-		}
+		float samplerec = PlayerSample(&p);
+		int8_t sample8bit = samplerec *127;
+		sample8bit += 128;
+		while (SecondsSince(&start) < PlayerSeconds(&p)){}//the emulation runs ahead, the wall clock only holds the samples back
+		bcm2835_spi_transfer(sample8bit);
     }
 	bcm2835_spi_end();
 	bcm2835_close();
 }
-
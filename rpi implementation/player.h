@@ -0,0 +1,141 @@
+/*
+ * player.h
+ *
+ * runs an nsf song against emulated time, shared by the spi player and the wav renderer
+ * play calls, frame counter steps and samples are all scheduled in cpu cycles so the
+ * output is the same no matter how fast the host is
+ */
+
+
+#ifndef PLAYER_H_
+#define PLAYER_H_
+#include "cpu.h"
+#include "loop.h"
+#define SECONDSPERPLAYCALL .01664 //used when the nsf doesnt give a play rate
+#define FRAMECOUNTERSPERSECOND 240
+#define INITMAXSECONDS 1 //init routines that take longer than this are treated as hung
+#define PLAYERDEFAULTSONG 0xFF //song number that picks the one the file says to start on
+
+struct player{
+	struct cpu c;
+	uint32_t samplerate;
+	uint32_t playcycles;//cycles between play calls
+	uint64_t now;//emulated time in cycles
+	uint64_t playstart;//when the first play call happened
+	uint64_t nextplay;
+	uint64_t nextframe;
+	uint64_t nextsample;
+	uint64_t samples;//samples made so far
+	uint64_t frames;//frame counter steps so far
+	struct loopfinder* loop;//gets every play call when set, NULL otherwise
+};
+
+uint8_t PlayerInit(struct player* p, const struct rom* r, uint8_t song, uint32_t samplerate){
+	//runs init for song (counting from 0), returns 1 if it never finishes
+	struct cpu* c = &p->c;
+	APUInit(&(c->a));
+	APUSampleRate(&(c->a),samplerate);
+	InitCpu(c);
+	LoadROM(c,r);
+	p->samplerate = samplerate;
+	p->playcycles = c->playspeed ? c->playspeed * (CPUCLOCK / 1000000.0) : SECONDSPERPLAYCALL * CPUCLOCK;
+	if (song == PLAYERDEFAULTSONG){
+		song = r->startingsong ? r->startingsong - 1 : 0;//the header counts from 1
+	}
+	c->acc = song;
+	c->x = 0;//ntsc
+	c->progcount = c->initadd;
+	c->playing = 1;
+	while (c->playing && c->clocks < INITMAXSECONDS * CPUCLOCK){
+		RunCycles(c,p->playcycles);
+	}
+	if (c->playing){
+		fprintf(stderr,"init never returned\n");
+		return 1;
+	}
+	p->now = c->deadline;
+	p->playstart = p->now;
+	p->nextplay = p->now;
+	p->nextframe = p->now;
+	p->nextsample = p->now;
+	p->samples = 0;
+	p->frames = 0;
+	p->loop = NULL;
+	return 0;
+}
+
+void PlayerAdvance(struct player* p){
+	//runs the cpu up to the next sample doing play calls and frame counter steps on the way, now is left on the sample
+	struct cpu* c = &p->c;
+	while (1){
+		uint64_t next = p->nextplay < p->nextframe ? p->nextplay : p->nextframe;
+		if (p->nextsample < next){next = p->nextsample;}
+		RunCycles(c,next - p->now);
+		p->now = next;
+		if (p->now == p->nextplay){
+			if (!c->playing){//a play call that runs long just makes the next one wait
+				if (p->loop){
+					LoopFrame(p->loop,c,(p->now - p->playstart) / p->playcycles);
+				}
+				c->playing = 1;
+				c->progcount = c->playadd;
+			}
+			p->nextplay += p->playcycles;
+		}
+		if (p->now == p->nextframe){
+			APUFrameStep(&(c->a));
+			p->frames++;
+			p->nextframe = p->playstart + (uint64_t)(p->frames * CPUCLOCK / FRAMECOUNTERSPERSECOND);
+		}
+		if (p->now == p->nextsample){
+			p->samples++;
+			p->nextsample = p->playstart + (uint64_t)(p->samples * CPUCLOCK / p->samplerate);
+			return;
+		}
+	}
+}
+
+float PlayerSample(struct player* p){//gives back the next sample from 0 to 1
+	PlayerAdvance(p);
+	return APUSample(&(p->c.a));
+}
+
+double PlayerSeconds(struct player* p){//emulated time covered by the samples made so far
+	return (double)p->samples / p->samplerate;
+}
+
+#define PLAYERSTATESIZE (STATESIZE + 64) //the cpu plus the player's own timing
+uint32_t SyncPlayerState(struct player* p, uint8_t* buf, uint8_t save){
+	uint8_t* q = buf + STATESIZE;
+	q = StateBytes(q,&p->samplerate,4,save);
+	q = StateBytes(q,&p->playcycles,4,save);
+	q = StateBytes(q,&p->now,8,save);
+	q = StateBytes(q,&p->playstart,8,save);
+	q = StateBytes(q,&p->nextplay,8,save);
+	q = StateBytes(q,&p->nextframe,8,save);
+	q = StateBytes(q,&p->nextsample,8,save);
+	q = StateBytes(q,&p->samples,8,save);
+	q = StateBytes(q,&p->frames,8,save);
+	return q - buf;
+}
+uint32_t PlayerSaveState(struct player* p, uint8_t* buf, uint32_t size){//gives back the bytes written, 0 if buf is too small
+	if (size < PLAYERSTATESIZE || SyncPlayerState(p,buf,STATEMEASURE) != PLAYERSTATESIZE || !SaveState(&p->c,buf,size)){
+		return 0;
+	}
+	return SyncPlayerState(p,buf,STATESAVE);
+}
+uint8_t PlayerLoadState(struct player* p, const struct rom* r, const uint8_t* buf, uint32_t size){
+	//p has to be zeroed or already playing something, returns 1 if buf cant be loaded
+	if (p->c.rom != r){//a player already on r keeps its engine caches
+		FreeCpu(&p->c);
+		APUInit(&(p->c.a));
+		InitCpu(&p->c);
+		LoadROM(&p->c,r);
+	}
+	if (size < PLAYERSTATESIZE || SyncPlayerState(p,(uint8_t*)buf,STATEMEASURE) != PLAYERSTATESIZE || LoadState(&p->c,buf,size)){
+		return 1;
+	}
+	SyncPlayerState(p,(uint8_t*)buf,STATELOAD);//only read from when loading
+	return 0;
+}
+#endif /* PLAYER_H_ */
@@ -0,0 +1,110 @@
+/*
+ * profile.h
+ *
+ * counts executions and cycles per opcode, per pc and per subroutine in RunInstruction, built with -DPROFILE_CPU
+ * subroutines are found from jsr/rts the same way depth is kept, each one gets the cycles run in its own body (self)
+ * and the cycles from its jsr to its rts including whatever it called (total)
+ * the report goes to stderr from FreeCpu, without PROFILE_CPU none of this gets compiled
+ */
+
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+#define PROFILETOP 16 //lines in each part of the report
+
+struct profile{
+	uint64_t cycles;//everything run so far
+	uint64_t opcount[0x100];
+	uint64_t opcycles[0x100];
+	uint64_t pccount[0x10000];
+	uint64_t pccycles[0x10000];
+	uint64_t subcalls[0x10000];//by the address the subroutine starts at
+	uint64_t subself[0x10000];
+	uint64_t subtotal[0x10000];
+	uint16_t callstack[0x100];//start of the subroutine running at each depth, 0 is play or init
+	uint64_t callstart[0x100];//cycles when it was entered
+	uint8_t rootopen;//1 while a play or init call is being run
+};
+
+void ProfileInstruction(struct cpu* c, uint16_t pc, uint8_t op, uint16_t addr, uint8_t depth, uint8_t cycles){
+	//called after every instruction with the pc it was at and the depth from before it ran
+	struct profile* p = c->prof;
+	if (!p){
+		p = c->prof = (struct profile*)calloc(1,sizeof(struct profile));
+		if (!p){
+			return;
+		}
+	}
+	if (!p->rootopen){//first instruction of a play or init call
+		p->rootopen = 1;
+		p->callstack[0] = pc;
+		p->callstart[0] = p->cycles;
+		p->subcalls[pc]++;
+	}
+	uint16_t sub = p->callstack[depth];
+	p->cycles += cycles;
+	p->opcount[op]++;
+	p->opcycles[op] += cycles;
+	p->pccount[pc]++;
+	p->pccycles[pc] += cycles;
+	p->subself[sub] += cycles;
+	if (c->depth > depth){//jsr
+		p->callstack[c->depth] = addr;
+		p->callstart[c->depth] = p->cycles;
+		p->subcalls[addr]++;
+	}
+	else if (c->depth < depth || !c->playing){//rts, or play/init returning
+		p->subtotal[sub] += p->cycles - p->callstart[depth];
+		if (!c->playing){
+			p->rootopen = 0;
+		}
+	}
+}
+
+uint32_t ProfileTop(const uint64_t* counts, uint32_t n, uint32_t* top){
+	//indexes of the PROFILETOP biggest nonzero counts, biggest first, gives back how many there were
+	uint32_t found = 0;
+	for (uint32_t i = 0; i < n; i++){
+		if (!counts[i]){
+			continue;
+		}
+		if (found == PROFILETOP && counts[i] <= counts[top[found - 1]]){
+			continue;
+		}
+		uint32_t j = found < PROFILETOP ? found++ : PROFILETOP - 1;//a full list loses its smallest
+		while (j && counts[top[j - 1]] < counts[i]){//insertion sort into the short list
+			top[j] = top[j - 1];
+			j--;
+		}
+		top[j] = i;
+	}
+	return found;
+}
+
+void ProfileReport(struct cpu* c, FILE* f){
+	struct profile* p = c->prof;
+	uint32_t top[PROFILETOP];
+	if (!p || !p->cycles){
+		return;
+	}
+	double total = p->cycles;
+	fprintf(f,"profile: %llu cycles\n",(unsigned long long)p->cycles);
+	fprintf(f,"opcodes by cycles:\n");
+	for (uint32_t i = 0, n = ProfileTop(p->opcycles,0x100,top); i < n; i++){
+		uint8_t op = top[i];
+		fprintf(f,"  %02X %.3s %-6s %12llu runs %12llu cycles %5.1f%%\n",op,&opnames[op * 3],amodenames[opcodes[op].amode],
+			(unsigned long long)p->opcount[op],(unsigned long long)p->opcycles[op],100.0 * p->opcycles[op] / total);
+	}
+	fprintf(f,"pcs by cycles:\n");
+	for (uint32_t i = 0, n = ProfileTop(p->pccycles,0x10000,top); i < n; i++){
+		fprintf(f,"  $%04X %12llu runs %12llu cycles %5.1f%%\n",top[i],
+			(unsigned long long)p->pccount[top[i]],(unsigned long long)p->pccycles[top[i]],100.0 * p->pccycles[top[i]] / total);
+	}
+	fprintf(f,"subroutines by total cycles:\n");
+	for (uint32_t i = 0, n = ProfileTop(p->subtotal,0x10000,top); i < n; i++){
+		fprintf(f,"  $%04X %10llu calls %12llu total %5.1f%% %12llu self %5.1f%%\n",top[i],(unsigned long long)p->subcalls[top[i]],
+			(unsigned long long)p->subtotal[top[i]],100.0 * p->subtotal[top[i]] / total,
+			(unsigned long long)p->subself[top[i]],100.0 * p->subself[top[i]] / total);
+	}
+}
+#endif /* PROFILE_H_ */
@@ -0,0 +1,325 @@
+/*
+ * render.c
+ *
+ * renders songs from an nsf file to wav files as fast as the host can go, no spi or bcm2835 needed
+ * usage: render [-l loops] [-f fade] [-s silence] [-o offset] [-a] [-t trace.bin] file.nsf track seconds samplerate out.wav [threads]
+ * track counts from 1 like the nsf header does, 0 plays the file's starting song
+ * track "all" renders every song in the file on a pool of threads, song n goes to out_n.wav
+ * songs that loop stop after the intro and loops times through the loop plus fade seconds of fading out,
+ * seconds is only the cut off for ones that dont, -l 0 always renders the full seconds
+ * songs also stop once every apu channel has been quiet for silence seconds, -s 0 turns that off
+ * -o starts the wav offset seconds into the song, getting there through a seek index (see seek.h),
+ * seconds still counts from the start of the song as do loops, -a and -t still see all of it,
+ * silence is only looked for from the offset on
+ * -a also saves the apu writes of each song next to its wav as out.apu (see apulog.h), giving one of those
+ * instead of the nsf renders it again without running the cpu, track is ignored then
+ * -t keeps a trace of a single track and writes it to trace.bin when it ends, crashes or gets SIGUSR1 (see tracedump.c)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "player.h"
+#include "seek.h"
+#include "wav.h"
+#define MAXTHREADS 64
+#define RENDERLOOPS 2 //times through the loop before fading out
+#define RENDERFADESECONDS 5.0
+#define RENDERSILENCESECONDS 3.0 //quiet for this long means the song is over
+
+struct rendersettings{
+	double seconds;//longest a song can be
+	uint32_t samplerate;
+	uint32_t loops;//0 to not look for loops
+	double fade;//seconds of fade after the last loop
+	double silence;//seconds of silence that end a song, 0 to never stop early
+	double offset;//seconds into the song the wav starts
+	uint8_t savelog;//1 to write out.apu next to out.wav
+	const char* tracepath;//NULL unless tracing
+};
+struct batch{//the songs left to render, shared by the worker threads
+	const struct rom* r;
+	const struct rendersettings* s;
+	char prefix[256];//out.wav without the .wav
+	pthread_mutex_t lock;
+	uint16_t next;//next song to hand out, counting from 1
+	uint8_t failed;
+};
+
+uint8_t RenderSeek(struct player* p, const struct rom* r, uint32_t samplerate, uint64_t sample){
+	//runs p from right after init up to sample through a fresh seek index, returns 1 if it couldnt
+	struct seekindex idx;
+	SeekInit(&idx,r,samplerate,SEEKDEFAULTINTERVAL);
+	uint8_t failed = SeekRecord(&idx,p) || SeekTo(&idx,p,sample);//state 0 has to be in before SeekTo can use the index
+	SeekFree(&idx);
+	return failed;
+}
+
+uint8_t RenderSong(const struct rom* r, uint8_t song, const struct rendersettings* s, const char* path){
+	//renders one song (counting from 0) into path, returns 1 if it couldnt
+	struct player* p = (struct player*)malloc(sizeof(struct player));//every song gets its own cpu and apu
+	struct wavwriter w;
+	struct loopfinder l;
+	struct apulog log;
+	if (!p){
+		printf("out of memory for %s\n",path);
+		return 1;
+	}
+	uint8_t failed = PlayerInit(p,r,song,s->samplerate);
+	if (!failed && WavOpen(&w,path,s->samplerate)){
+		printf("could not write %s\n",path);
+		failed = 1;
+	}
+	if (!failed){
+		uint64_t total = s->seconds * s->samplerate;
+		uint64_t fadelen = s->fade * s->samplerate;
+		uint64_t fadestart = total;
+		uint64_t silencelen = s->silence * s->samplerate;
+		uint64_t quiet = 0;//samples in a row the apu has been silent for
+		uint64_t first = s->offset * s->samplerate;
+		if (s->loops){
+			LoopInit(&l);
+			p->loop = &l;
+		}
+		if (s->savelog){
+			APULogStart(&log,&(p->c.a),p->playstart);
+			p->c.log = &log;
+		}
+		if (s->tracepath){
+			p->c.trace = (struct trace*)calloc(1,sizeof(struct trace));
+			if (p->c.trace){
+				TraceOnSignal(p->c.trace,s->tracepath);
+			}
+			else{
+				printf("out of memory for the trace of %s\n",path);
+				failed = 1;
+			}
+		}
+		if (!failed && first && RenderSeek(p,r,s->samplerate,first)){//after the loop finder, log and trace are on so they still get the skipped part
+			printf("could not seek %s to %.2f s\n",path,s->offset);
+			failed = 1;
+		}
+		for (uint64_t i = first; i < total && !failed; i++){//i counts from the start of the song so loops and fades line up
+			float sample = PlayerSample(p);
+			if (p->loop && l.found){//now we know how long the song really is
+				double frameseconds = p->playcycles / CPUCLOCK;
+				uint64_t end = (l.introframes + (double)l.loopframes * s->loops) * frameseconds * s->samplerate;
+				printf("%s: intro %.2f s, loop %.2f s\n",path,l.introframes * frameseconds,l.loopframes * frameseconds);
+				if (end + fadelen < total){
+					total = end + fadelen;
+					fadestart = end;
+				}
+				p->loop = NULL;
+			}
+			if (i >= fadestart){
+				sample = .5 + (sample - .5) * (double)(total - i) / fadelen;
+			}
+			WavSample(&w,sample);
+			quiet = APUSilent(&(p->c.a)) ? quiet + 1 : 0;
+			if (silencelen && quiet >= silencelen){
+				printf("%s: silent from %.2f s\n",path,(double)(i + 1 - quiet) / s->samplerate);
+				break;
+			}
+		}
+		WavClose(&w);
+		if (s->loops){
+			LoopFree(&l);
+		}
+		if (s->savelog){
+			char logpath[300];
+			size_t len = strlen(path);
+			if (len >= 4 && !strcmp(path + len - 4,".wav")){len -= 4;}
+			snprintf(logpath,sizeof(logpath),"%.*s.apu",(int)len,path);
+			APULogFinish(&log,p->now);
+			if (APULogSave(&log,logpath)){
+				printf("could not write %s\n",logpath);
+				failed = 1;
+			}
+			APULogFree(&log);
+		}
+		if (p->c.trace){
+			if (TraceDump(p->c.trace,s->tracepath)){
+				printf("could not write %s\n",s->tracepath);
+				failed = 1;
+			}
+			TraceOffSignal();
+			free(p->c.trace);
+		}
+	}
+	FreeCpu(&p->c);
+	free(p);
+	return failed;
+}
+
+uint8_t RenderLog(const uint8_t* data, uint32_t size, const struct rendersettings* s, const char* path){
+	//plays a saved log into path, no cpu involved, returns 1 if it couldnt
+	struct apulogplayer lp;
+	struct wavwriter w;
+	if (APULogPlayerInit(&lp,data,size,s->samplerate)){
+		printf("not an apu log this version can play\n");
+		return 1;
+	}
+	if (WavOpen(&w,path,s->samplerate)){
+		printf("could not write %s\n",path);
+		return 1;
+	}
+	uint64_t total = s->seconds * s->samplerate;
+	uint64_t first = s->offset * s->samplerate;
+	for (uint64_t i = 0; i < total && !lp.done; i++){
+		float sample = APULogPlayerSample(&lp);//a log has no states to seek with, so the offset just gets played and dropped
+		if (i >= first){
+			WavSample(&w,sample);
+		}
+	}
+	WavClose(&w);
+	return 0;
+}
+
+void* RenderWorker(void* arg){
+	struct batch* b = (struct batch*)arg;
+	while (1){
+		pthread_mutex_lock(&b->lock);
+		uint16_t song = b->next++;
+		pthread_mutex_unlock(&b->lock);
+		if (song > b->r->totalsongs){
+			return NULL;
+		}
+		char path[300];
+		snprintf(path,sizeof(path),"%s_%02d.wav",b->prefix,song);
+		if (RenderSong(b->r,song - 1,b->s,path)){
+			pthread_mutex_lock(&b->lock);
+			b->failed = 1;
+			pthread_mutex_unlock(&b->lock);
+		}
+	}
+}
+
+uint8_t RenderAll(const struct rom* r, const struct rendersettings* s, const char* out, int threads){
+	//renders every song on a fixed pool of threads, returns 1 if any of them failed or there were none
+	if (!r->totalsongs){
+		printf("the nsf says it has no songs\n");
+		return 1;
+	}
+	struct batch b;//the workers are all joined before this goes away
+	pthread_t workers[MAXTHREADS];
+	b.r = r;
+	b.s = s;
+	snprintf(b.prefix,sizeof(b.prefix),"%s",out);
+	size_t len = strlen(b.prefix);
+	if (len >= 4 && !strcmp(b.prefix + len - 4,".wav")){
+		b.prefix[len - 4] = 0;
+	}
+	pthread_mutex_init(&b.lock,NULL);
+	b.next = 1;
+	b.failed = 0;
+	APUTablesInit();//before any worker gets to APUInit, which would otherwise build them on several threads at once
+	if (threads > r->totalsongs){threads = r->totalsongs;}
+	for (int i = 0; i < threads; i++){
+		pthread_create(&workers[i],NULL,RenderWorker,&b);
+	}
+	for (int i = 0; i < threads; i++){
+		pthread_join(workers[i],NULL);
+	}
+	pthread_mutex_destroy(&b.lock);
+	return b.failed;
+}
+
+int main(int argc, char** argv){
+	struct rendersettings s;
+	s.loops = RENDERLOOPS;
+	s.fade = RENDERFADESECONDS;
+	s.silence = RENDERSILENCESECONDS;
+	s.offset = 0;
+	s.savelog = 0;
+	s.tracepath = NULL;
+	int opt;
+	while ((opt = getopt(argc,argv,"l:f:s:o:at:")) != -1){
+		switch (opt){
+			case 'l':
+				s.loops = atoi(optarg);
+				break;
+			case 'f':
+				s.fade = atof(optarg);
+				break;
+			case 's':
+				s.silence = atof(optarg);
+				break;
+			case 'o':
+				s.offset = atof(optarg);
+				break;
+			case 'a':
+				s.savelog = 1;
+				break;
+			case 't':
+				s.tracepath = optarg;
+				break;
+			default:
+				argc = 0;//prints the usage below
+				break;
+		}
+	}
+	argv += optind;
+	argc -= optind;
+	if (argc != 5 && argc != 6){
+		printf("usage: render [-l loops] [-f fade] [-s silence] [-o offset] [-a] [-t trace.bin] file.nsf track|all seconds samplerate out.wav [threads]\n");
+		return 1;
+	}
+	uint8_t all = !strcmp(argv[1],"all");
+	int track = atoi(argv[1]);
+	s.seconds = atof(argv[2]);
+	int samplerate = atoi(argv[3]);
+	int threads = argc == 6 ? atoi(argv[5]) : sysconf(_SC_NPROCESSORS_ONLN);
+	if (track < 0 || track > 255 || s.seconds <= 0 || samplerate <= 0 || s.fade < 0 || s.silence < 0 || s.offset < 0){
+		printf("bad track, length, sample rate, fade, silence or offset\n");
+		return 1;
+	}
+	s.samplerate = samplerate;
+	if (threads < 1){threads = 1;}
+	if (threads > MAXTHREADS){threads = MAXTHREADS;}
+	FILE* f = fopen(argv[0],"rb");
+	uint8_t magic[4] = {0,0,0,0};
+	if (f){
+		fread(magic,1,4,f);
+	}
+	if (f && magic[0] == 'A' && magic[1] == 'P' && magic[2] == 'U' && magic[3] == 'L'){//a log from -a
+		fseek(f,0,SEEK_END);
+		long size = ftell(f);
+		uint8_t* data = size > 0 ? (uint8_t*)malloc(size) : NULL;
+		fseek(f,0,SEEK_SET);
+		if (!data){
+			printf("out of memory for %s\n",argv[0]);
+			fclose(f);
+			return 1;
+		}
+		uint8_t failed = fread(data,1,size,f) != (size_t)size || RenderLog(data,size,&s,argv[4]);
+		free(data);
+		fclose(f);
+		return failed;
+	}
+	if (f){
+		fclose(f);
+	}
+	struct rom* r = OpenROM(argv[0]);//read once, every song shares it
+	if (!r){
+		return 1;
+	}
+	uint8_t failed = 0;
+	if (all && s.tracepath){
+		printf("-t only works on one track\n");
+		failed = 1;
+	}
+	else if (all){
+		failed = RenderAll(r,&s,argv[4],threads);
+	}
+	else if (r->totalsongs && track > r->totalsongs){
+		printf("%s only has %d songs\n",argv[0],r->totalsongs);
+		failed = 1;
+	}
+	else{
+		failed = RenderSong(r,track ? track - 1 : PLAYERDEFAULTSONG,&s,argv[4]);
+	}
+	CloseROM(r);
+	return failed;
+}
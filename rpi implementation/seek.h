@@ -0,0 +1,82 @@
+/*
+ * seek.h
+ *
+ * seek index for a player, a saved state every interval samples so getting anywhere in a song
+ * only means loading the closest state before it and running forward from there
+ * the index fills in as the song gets played or seeked through, nothing is rendered ahead of time
+ */
+
+
+#ifndef SEEK_H_
+#define SEEK_H_
+#include "player.h"
+#define SEEKDEFAULTINTERVAL 1.0 //seconds between saved states
+
+struct seekindex{
+	const struct rom* r;
+	uint64_t interval;//samples between saved states, state i is from sample i*interval
+	uint32_t count;//states saved so far
+	uint32_t capacity;
+	uint8_t* states;//count states of PLAYERSTATESIZE bytes each
+};
+
+void SeekInit(struct seekindex* s, const struct rom* r, uint32_t samplerate, double seconds){
+	s->r = r;
+	s->interval = seconds * samplerate;
+	if (!s->interval){s->interval = 1;}
+	s->count = 0;
+	s->capacity = 0;
+	s->states = NULL;
+}
+
+void SeekFree(struct seekindex* s){
+	free(s->states);
+	s->states = NULL;
+	s->count = 0;
+	s->capacity = 0;
+}
+
+uint8_t SeekRecord(struct seekindex* s, struct player* p){
+	//call between samples, saves p if it is sitting on the next missing state, returns 1 if it couldnt be saved
+	if (p->samples != s->count * s->interval){
+		return 0;
+	}
+	if (s->count == s->capacity){
+		uint32_t cap = s->capacity ? s->capacity * 2 : 64;
+		uint8_t* grown = (uint8_t*)realloc(s->states,(size_t)cap * PLAYERSTATESIZE);
+		if (!grown){
+			return 1;
+		}
+		s->states = grown;
+		s->capacity = cap;
+	}
+	if (!PlayerSaveState(p,s->states + (size_t)s->count * PLAYERSTATESIZE,PLAYERSTATESIZE)){
+		return 1;
+	}
+	s->count++;
+	return 0;
+}
+
+uint8_t SeekTo(struct seekindex* s, struct player* p, uint64_t sample){
+	//puts p right before sample, p has to be zeroed or already playing s->r, returns 1 if it couldnt
+	//samples on the way there get made and thrown away since the apu carries its oscillators and filter from one sample to the next,
+	//states passed on the way get added to the index
+	if (!s->count){//state 0 is sample 0, right after init
+		return 1;
+	}
+	uint64_t i = sample / s->interval;
+	if (i >= s->count){
+		i = s->count - 1;
+	}
+	if (p->c.rom != s->r || p->samples > sample || p->samples < i * s->interval){//otherwise p is already closer than the state
+		if (PlayerLoadState(p,s->r,s->states + (size_t)i * PLAYERSTATESIZE,PLAYERSTATESIZE)){
+			return 1;
+		}
+	}
+	while (p->samples < sample){
+		PlayerSample(p);
+		SeekRecord(s,p);
+	}
+	return 0;
+}
+#endif /* SEEK_H_ */
@@ -0,0 +1,116 @@
+/*
+ * trace.h
+ *
+ * ring buffer of the last TRACESIZE things the cpu did, for finding out what a track did before it went wrong
+ * filling it is a handful of plain stores per instruction or write, nothing gets formatted until tracedump reads it
+ * instructions are only seen by RunInstruction, the other engines just leave the writes in it
+ * TraceDump writes it to a file, TraceOnSignal does the same when the process crashes or gets SIGUSR1
+ */
+
+
+#ifndef TRACE_H_
+#define TRACE_H_
+#include <signal.h>
+#define TRACESIZE 0x4000 //entries kept, has to be a power of 2
+#define TRACEVERSION 1
+#define TRACEINST 1 //an instruction about to run
+#define TRACEWRITE 2 //a write it made
+
+struct traceentry{//16 bytes, a dump is a header then these in host byte order
+	uint8_t kind;//TRACEINST or TRACEWRITE
+	uint8_t op;//opcode, or the value for a write
+	uint16_t pc;//where the instruction is, or the address for a write
+	uint16_t addr;//effective address of the instruction, or progcount for a write (see TraceWrite)
+	uint8_t operand[2];//bytes after the opcode
+	uint8_t acc;
+	uint8_t x;
+	uint8_t y;
+	uint8_t s;
+	uint8_t p;
+	uint8_t depth;
+	uint8_t cycles;//base cost of the instruction
+};
+struct trace{
+	uint32_t head;//total entries ever added, the newest one is at (head - 1) % TRACESIZE
+	struct traceentry entries[TRACESIZE];
+};
+
+void TraceInstruction(struct cpu* c, uint8_t cycles, uint16_t addr){//call with progcount still on the opcode
+	struct traceentry* e = &c->trace->entries[c->trace->head++ & (TRACESIZE - 1)];
+	e->kind = TRACEINST;
+	e->op = c->instbuffer[0];
+	e->pc = c->progcount;
+	e->addr = addr;
+	e->operand[0] = c->instbuffer[1];
+	e->operand[1] = c->instbuffer[2];
+	e->acc = c->acc;
+	e->x = c->x;
+	e->y = c->y;
+	e->s = c->s;
+	e->p = GetStatus(c);
+	e->depth = c->depth;
+	e->cycles = cycles;
+}
+
+void TraceWrite(struct cpu* c, uint16_t pos, uint8_t val){
+	//addr gets progcount as it is, under RunInstruction that is the instruction after the one writing,
+	//the other engines dont store it after every instruction so there it can be stale
+	//the instruction itself is the TRACEINST right before this when RunInstruction is running
+	struct traceentry* e = &c->trace->entries[c->trace->head++ & (TRACESIZE - 1)];
+	e->kind = TRACEWRITE;
+	e->op = val;
+	e->pc = pos;
+	e->addr = c->progcount;
+}
+
+uint8_t TraceWriteFd(const struct trace* t, int fd){
+	//only uses write so it is safe from a signal handler, returns 1 if it couldnt
+	const uint8_t head[12] = {'T','R','C','E',TRACEVERSION,sizeof(struct traceentry),0,0,
+		t->head & 0xFF,(t->head >> 8) & 0xFF,(t->head >> 16) & 0xFF,(t->head >> 24) & 0xFF};
+	return write(fd,head,sizeof(head)) != sizeof(head) || write(fd,t->entries,sizeof(t->entries)) != sizeof(t->entries);
+}
+
+uint8_t TraceDump(const struct trace* t, const char* path){//returns 1 if it couldnt
+	int fd = open(path,O_WRONLY | O_CREAT | O_TRUNC,0644);
+	if (fd < 0){
+		return 1;
+	}
+	uint8_t failed = TraceWriteFd(t,fd);
+	return close(fd) || failed;
+}
+
+const struct trace* signaltrace;//what the handler dumps, only one trace can be watched at a time
+const char* signalpath;
+void TraceSignal(int sig){
+	int fd = open(signalpath,O_WRONLY | O_CREAT | O_TRUNC,0644);
+	if (fd >= 0){
+		TraceWriteFd(signaltrace,fd);
+		close(fd);
+	}
+	if (sig != SIGUSR1){//let the crash go on as it would have
+		signal(sig,SIG_DFL);
+		raise(sig);
+	}
+}
+
+void TraceOnSignal(const struct trace* t, const char* path){
+	//dumps t to path on a crash, or whenever the process gets SIGUSR1 and keeps going
+	signaltrace = t;
+	signalpath = path;
+	signal(SIGSEGV,TraceSignal);
+	signal(SIGBUS,TraceSignal);
+	signal(SIGILL,TraceSignal);
+	signal(SIGFPE,TraceSignal);
+	signal(SIGABRT,TraceSignal);
+	signal(SIGUSR1,TraceSignal);
+}
+
+void TraceOffSignal(void){//puts the signals back, for before the trace being watched goes away
+	signal(SIGSEGV,SIG_DFL);
+	signal(SIGBUS,SIG_DFL);
+	signal(SIGILL,SIG_DFL);
+	signal(SIGFPE,SIG_DFL);
+	signal(SIGABRT,SIG_DFL);
+	signal(SIGUSR1,SIG_DFL);
+}
+#endif /* TRACE_H_ */
@@ -0,0 +1,76 @@
+/*
+ * tracedump.c
+ *
+ * prints a trace written by TraceDump or the trace signal handler, oldest entry first
+ * usage: tracedump trace.bin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "cpu.h"
+
+void PrintOperand(const struct traceentry* e){
+	uint8_t zp = e->operand[0];
+	uint16_t abs = (e->operand[1] << 8) + e->operand[0];
+	switch (opcodes[e->op].amode){
+		case AM_ACC: printf("A         "); break;
+		case AM_IMM: printf("#$%02X      ",zp); break;
+		case AM_ZPG: printf("$%02X       ",zp); break;
+		case AM_ZPX: printf("$%02X,X     ",zp); break;
+		case AM_ZPY: printf("$%02X,Y     ",zp); break;
+		case AM_ABS: printf("$%04X     ",abs); break;
+		case AM_ABX: printf("$%04X,X   ",abs); break;
+		case AM_ABY: printf("$%04X,Y   ",abs); break;
+		case AM_IND: printf("($%04X)   ",abs); break;
+		case AM_IZX: printf("($%02X,X)   ",zp); break;
+		case AM_IZY: printf("($%02X),Y   ",zp); break;
+		case AM_REL: printf("$%04X     ",(uint16_t)(e->pc + 2 + (int8_t)zp)); break;
+		default: printf("          "); break;
+	}
+}
+
+int main(int argc, char** argv){
+	if (argc != 2){
+		printf("usage: %s trace.bin\n",argv[0]);
+		return 1;
+	}
+	FILE* f = fopen(argv[1],"rb");
+	if (!f){
+		printf("could not open %s\n",argv[1]);
+		return 1;
+	}
+	static struct trace t;
+	uint8_t head[12];
+	if (fread(head,1,sizeof(head),f) != sizeof(head) || head[0] != 'T' || head[1] != 'R' || head[2] != 'C' || head[3] != 'E'
+		|| head[4] != TRACEVERSION || head[5] != sizeof(struct traceentry) || fread(t.entries,1,sizeof(t.entries),f) != sizeof(t.entries)){
+		printf("%s is not a trace this version can read\n",argv[1]);
+		fclose(f);
+		return 1;
+	}
+	fclose(f);
+	t.head = head[8] | (head[9] << 8) | (head[10] << 16) | ((uint32_t)head[11] << 24);
+	uint32_t count = t.head < TRACESIZE ? t.head : TRACESIZE;
+	printf("%u entries, last %u kept\n",t.head,count);
+	for (uint32_t i = t.head - count; i != t.head; i++){
+		const struct traceentry* e = &t.entries[i & (TRACESIZE - 1)];
+		if (e->kind == TRACEINST){
+			uint8_t len = opcodes[e->op].length;
+			printf("%04X  %02X ",e->pc,e->op);
+			printf(len > 1 ? "%02X " : "   ",e->operand[0]);
+			printf(len > 2 ? "%02X  " : "    ",e->operand[1]);
+			printf("%.3s ",&opnames[e->op * 3]);
+			PrintOperand(e);
+			printf("A:%02X X:%02X Y:%02X S:%02X P:%c%c--%c%c%c%c depth:%d",e->acc,e->x,e->y,e->s,
+				e->p & 0x80 ? 'N' : 'n',e->p & 0x40 ? 'V' : 'v',e->p & 0x08 ? 'D' : 'd',e->p & 0x04 ? 'I' : 'i',
+				e->p & 0x02 ? 'Z' : 'z',e->p & 0x01 ? 'C' : 'c',e->depth);
+			if (opcodes[e->op].amode >= AM_ZPX && opcodes[e->op].amode != AM_ABS && opcodes[e->op].amode != AM_REL){
+				printf(" @%04X",e->addr);//where indexing and indirection ended up
+			}
+			printf("\n");
+		}
+		else if (e->kind == TRACEWRITE){
+			printf("      write $%04X = %02X\n",e->pc,e->op);
+		}
+	}
+	return 0;
+}
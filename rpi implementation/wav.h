@@ -0,0 +1,67 @@
+/*
+ * wav.h
+ *
+ * writes mono 16 bit pcm wav files for the renderer
+ */
+
+
+#ifndef WAV_H_
+#define WAV_H_
+#include <stdint.h>
+#include <stdio.h>
+
+struct wavwriter{
+	FILE* f;
+	uint32_t samplerate;
+	uint32_t samples;//written so far, the header sizes get filled in from this on close
+};
+
+void WavWrite32(FILE* f, uint32_t val){//wav is little endian
+	fputc(val & 0xFF,f);
+	fputc((val >> 8) & 0xFF,f);
+	fputc((val >> 16) & 0xFF,f);
+	fputc((val >> 24) & 0xFF,f);
+}
+void WavWrite16(FILE* f, uint16_t val){
+	fputc(val & 0xFF,f);
+	fputc((val >> 8) & 0xFF,f);
+}
+void WavHeader(struct wavwriter* w){
+	uint32_t datasize = w->samples * 2;
+	fwrite("RIFF",1,4,w->f);
+	WavWrite32(w->f,36 + datasize);
+	fwrite("WAVEfmt ",1,8,w->f);
+	WavWrite32(w->f,16);//fmt chunk size
+	WavWrite16(w->f,1);//pcm
+	WavWrite16(w->f,1);//mono
+	WavWrite32(w->f,w->samplerate);
+	WavWrite32(w->f,w->samplerate * 2);//bytes per second
+	WavWrite16(w->f,2);//bytes per sample
+	WavWrite16(w->f,16);//bits per sample
+	fwrite("data",1,4,w->f);
+	WavWrite32(w->f,datasize);
+}
+
+uint8_t WavOpen(struct wavwriter* w, const char* path, uint32_t samplerate){//returns 1 if the file cant be made
+	w->f = fopen(path,"wb");
+	if (!w->f){
+		return 1;
+	}
+	w->samplerate = samplerate;
+	w->samples = 0;
+	WavHeader(w);//sizes are wrong until WavClose
+	return 0;
+}
+void WavSample(struct wavwriter* w, float sample){//sample goes from 0 to 1 like the player gives them
+	int32_t val = (sample - 0.5) * 65535;
+	if (val > 32767){val = 32767;}
+	if (val < -32768){val = -32768;}
+	WavWrite16(w->f,(uint16_t)val);
+	w->samples++;
+}
+void WavClose(struct wavwriter* w){
+	rewind(w->f);
+	WavHeader(w);
+	fclose(w->f);
+}
+#endif /* WAV_H_ */